@@ -0,0 +1,184 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <PubSubClient.h>
+#include "entity_state.h"
+#include "mqtt_link.h"
+#include "latency_stats.h"
+#include "panel_log.h"
+
+extern PubSubClient mqtt;
+
+// --- OUTGOING COMMAND QUEUE ---
+// Toggles are applied to the state store optimistically and queued here, one
+// entry per entity. Unsent entries coalesce (a double tap back to the original
+// state cancels the command), publishing is retried until MQTT is back, and a
+// command that HA does not confirm within CMD_CONFIRM_MS is rolled back.
+// Confirmation comes from cmd_queue_on_report(), which sees every state HA
+// reports: the store only notifies on changes, and the optimistic write has
+// already set the value the echo carries.
+
+#define CMD_QUEUE_MAX      16
+#define CMD_COALESCE_MS    150     // Taps closer than this are merged before sending
+#define CMD_RETRY_MS       1000
+#define CMD_CONFIRM_MS     5000    // Sent, waiting for HA to echo the new state
+#define CMD_STALE_MS       30000   // Never sent (offline); give up and roll back
+#define CMD_TOPIC          "ha/panel/command"
+
+struct PanelCommand {
+    const char* id;          // Interned, NULL = free slot
+    uint32_t queued_ms;      // Last tap
+    uint32_t sent_ms;        // 0 = not sent yet
+    uint32_t last_try_ms;
+    bool prev_on;            // State before the first tap, used for rollback
+    bool target_on;
+    bool fire_and_forget;    // Scenes never report a state back
+};
+
+PanelCommand cmd_queue[CMD_QUEUE_MAX];
+char cmd_payload[160];
+
+// Called whenever an entity gains or loses a pending command (e.g. to mark the button)
+void (*cmd_queue_pending_cb)(const char* id, bool pending) = NULL;
+// Called when a command is queued, so the caller can start running cmd_queue_process()
+void (*cmd_queue_wake_cb)() = NULL;
+
+uint32_t cmd_stats_sent = 0;
+uint32_t cmd_stats_coalesced = 0;
+uint32_t cmd_stats_rolled_back = 0;
+
+static PanelCommand* cmd_queue_find(const char* id) {
+    for (int i = 0; i < CMD_QUEUE_MAX; i++) {
+        if (cmd_queue[i].id == id) return &cmd_queue[i];
+    }
+    return NULL;
+}
+
+bool cmd_queue_is_pending(const char* id) {
+    return id != NULL && cmd_queue_find(id) != NULL;
+}
+
+bool cmd_queue_empty() {
+    for (int i = 0; i < CMD_QUEUE_MAX; i++) {
+        if (cmd_queue[i].id != NULL) return false;
+    }
+    return true;
+}
+
+static void cmd_queue_drop(PanelCommand* c) {
+    const char* id = c->id;
+    c->id = NULL;
+    if (cmd_queue_pending_cb) cmd_queue_pending_cb(id, false);
+}
+
+static void cmd_queue_write_state(const char* id, bool on) {
+    entity_state_set(id, on);
+}
+
+// Call for every state HA reports, changed or not, before it goes to the store.
+// A report matching a sent command's target confirms it; anything else is
+// remembered as the state to roll back to. Returns true while a command still
+// owns the entity: the caller must then leave on/off in the store alone, or the
+// button would flip back before the command is sent or confirmed.
+bool cmd_queue_on_report(const char* id, bool on) {
+    const EntityState* st = entity_state_find(id);
+    if (st == NULL) return false;   // Never stored, so never toggled
+    PanelCommand* c = cmd_queue_find(st->id);
+    if (c == NULL) return false;
+    if (c->sent_ms != 0 && on == c->target_on) {
+        latency_record_confirm(c->id, c->queued_ms, c->sent_ms, millis());
+        cmd_queue_drop(c);
+        return false;
+    }
+    c->prev_on = on;
+    return true;
+}
+
+// User tapped an entity. `id` must be interned (e.g. from the entity index).
+void cmd_queue_toggle(const char* id, bool prev_on, bool target_on) {
+    if (id == NULL) return;
+    bool scene = strncmp(id, "scene.", 6) == 0;
+    PanelCommand* c = cmd_queue_find(id);
+
+    if (c && c->sent_ms == 0) {
+        cmd_stats_coalesced++;
+        if (scene) return;   // Already queued, one activation is enough
+        if (target_on == c->prev_on) {
+            // Tapped back to where we started before anything was sent
+            cmd_queue_write_state(id, target_on);
+            cmd_queue_drop(c);
+            return;
+        }
+        c->target_on = target_on;
+        c->queued_ms = millis();
+        cmd_queue_write_state(id, target_on);
+        return;
+    }
+
+    if (c == NULL) {
+        c = cmd_queue_find(NULL);
+        if (c == NULL) {
+            LOG_W("CMD: Queue full, tap ignored");
+            return;
+        }
+        c->id = id;
+        c->prev_on = prev_on;
+        if (cmd_queue_pending_cb) cmd_queue_pending_cb(id, true);
+    }
+    // New entry, or a new tap while the previous command awaits confirmation
+    c->target_on = target_on;
+    c->fire_and_forget = scene;
+    c->queued_ms = millis();
+    c->sent_ms = 0;
+    c->last_try_ms = 0;
+    cmd_queue_write_state(id, target_on);
+    if (cmd_queue_wake_cb) cmd_queue_wake_cb();
+}
+
+static const char* cmd_action(const PanelCommand* c) {
+    if (c->fire_and_forget) return "turn_on";
+    if (strncmp(c->id, "cover.", 6) == 0) return c->target_on ? "open_cover" : "close_cover";
+    return c->target_on ? "turn_on" : "turn_off";
+}
+
+static bool cmd_publish(PanelCommand* c) {
+    int n = snprintf(cmd_payload, sizeof(cmd_payload), "{\"entity_id\":\"%s\",\"action\":\"%s\"}", c->id, cmd_action(c));
+    if (n <= 0 || n >= (int)sizeof(cmd_payload)) return false;
+    return mqtt.publish(CMD_TOPIC, cmd_payload);
+}
+
+static void cmd_rollback(PanelCommand* c, const char* why) {
+    (void)why;   // Only read by LOG_W, which may be compiled out
+    LOG_W("CMD: %s %s, rolling back", c->id, why);
+    cmd_stats_rolled_back++;
+    cmd_queue_write_state(c->id, c->prev_on);
+    cmd_queue_drop(c);
+}
+
+// Called while the queue is not empty: sends due commands and expires unconfirmed ones.
+void cmd_queue_process() {
+    uint32_t now = millis();
+    bool online = mqtt_link_ready();
+
+    for (int i = 0; i < CMD_QUEUE_MAX; i++) {
+        PanelCommand* c = &cmd_queue[i];
+        if (c->id == NULL) continue;
+
+        if (c->sent_ms != 0) {
+            if (now - c->sent_ms > CMD_CONFIRM_MS) cmd_rollback(c, "not confirmed");
+            continue;
+        }
+        if (now - c->queued_ms > CMD_STALE_MS) { cmd_rollback(c, "never sent"); continue; }
+        if (!online || now - c->queued_ms < CMD_COALESCE_MS) continue;
+        if (c->last_try_ms != 0 && now - c->last_try_ms < CMD_RETRY_MS) continue;
+
+        c->last_try_ms = now;
+        if (!cmd_publish(c)) continue;
+        cmd_stats_sent++;
+        latency_record_publish(c->queued_ms, now);
+        if (c->fire_and_forget) cmd_queue_drop(c);
+        else c->sent_ms = now;
+    }
+}
+
+#endif
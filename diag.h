@@ -0,0 +1,296 @@
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <lvgl.h>
+#include "mqtt_link.h"
+#include "telemetry.h"
+#include "panel_log.h"
+#include "obj_pool.h"
+#include "panel_arena.h"
+#include "heap_debug.h"
+#include "panel_codec.h"
+
+// --- REMOTE DIAGNOSTICS ---
+// Publish a command to ha/panel/<device>/diag and the panel answers on
+// ha/panel/<device>/diag/reply. Commands:
+//   tasks        FreeRTOS tasks (state, priority, core, stack left, CPU share) and load per core
+//   heap         free / largest block / fragmentation per memory capability, the LVGL pool and arenas
+//   lvgl         object counts per screen
+//   census       object counts per screen and widget type
+//   snap         take a heap/object baseline
+//   leaks        what grew since the baseline
+//   opdiff       the last operation diff (PANEL_HEAP_DEBUG builds)
+//   frames       render time and loop period histograms of the current telemetry interval
+//   codec [n]    size and parse time of an n-button config as JSON and as MessagePack
+//   log [n]      the last n log records, formatted on request
+//   crashlog     the log ring saved from before the last panic or watchdog reset
+//   help
+// The reply is plain text split into chunks of DIAG_CHUNK bytes. Each chunk
+// starts with a header line "<command> <part>/<parts>".
+// Requests are queued and answered from loop(), never inside the MQTT callback.
+
+#define DIAG_REPLY_MAX   8192
+#define DIAG_CHUNK       1024
+#define DIAG_CMD_LEN     32
+#define DIAG_CODEC_RUNS  20
+#define DIAG_CODEC_DEF   48       // Buttons in the benchmark config
+#define DIAG_CODEC_MAX   200
+
+int diag_route = -1;
+char diag_pending[DIAG_CMD_LEN];
+bool diag_has_pending = false;
+char diag_topic[64];
+
+// CPU load is measured between two "tasks" requests
+uint32_t diag_prev_total = 0;
+uint32_t diag_prev_idle[portNUM_PROCESSORS];
+
+// --- COMMANDS ---
+static int diag_tasks(char* buf, size_t len) {
+#if configUSE_TRACE_FACILITY
+    UBaseType_t cap = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t* st = (TaskStatus_t*)hd_malloc(HT_DIAG, cap * sizeof(TaskStatus_t));
+    if (st == NULL) return snprintf(buf, len, "out of memory\n");
+    uint32_t total = 0;
+    UBaseType_t count = uxTaskGetSystemState(st, cap, &total);
+
+    int n = snprintf(buf, len, "%-16s st pri core stack  cpu%%\n", "task");
+    uint32_t idle[portNUM_PROCESSORS] = {0};
+    for (UBaseType_t i = 0; i < count && n < (int)len; i++) {
+        const TaskStatus_t* t = &st[i];
+        static const char states[] = "XRBSD?";
+        int core = -1;
+#if configTASKLIST_INCLUDE_COREID
+        core = (t->xCoreID < portNUM_PROCESSORS) ? (int)t->xCoreID : -1;
+#endif
+        for (int c = 0; c < portNUM_PROCESSORS; c++) {
+            if (t->xHandle == xTaskGetIdleTaskHandleForCore(c)) idle[c] = t->ulRunTimeCounter;
+        }
+        uint32_t pct = total ? (uint32_t)((uint64_t)t->ulRunTimeCounter * 100 / total) : 0;
+        n += snprintf(buf + n, len - n, "%-16s %c %3u %4d %5u %4lu\n", t->pcTaskName,
+                      states[t->eCurrentState < 5 ? t->eCurrentState : 5], (unsigned)t->uxCurrentPriority,
+                      core, (unsigned)t->usStackHighWaterMark, (unsigned long)pct);
+    }
+    hd_free(st);
+
+    // The run time counter ticks per core, so each core's share is idle time over elapsed time
+    uint32_t elapsed = total - diag_prev_total;
+    for (int c = 0; c < portNUM_PROCESSORS && n < (int)len; c++) {
+        uint32_t idle_delta = idle[c] - diag_prev_idle[c];
+        uint32_t load = (elapsed && idle_delta <= elapsed) ? 100 - (uint32_t)((uint64_t)idle_delta * 100 / elapsed) : 0;
+        n += snprintf(buf + n, len - n, "core %d load: %lu%%\n", c, (unsigned long)load);
+        diag_prev_idle[c] = idle[c];
+    }
+    if (n < (int)len) n += snprintf(buf + n, len - n, "(load since the previous request, %lu ms)\n", (unsigned long)(elapsed / 1000));
+    diag_prev_total = total;
+    return n;
+#else
+    return snprintf(buf, len, "task stats not available in this build\n");
+#endif
+}
+
+static int diag_heap(char* buf, size_t len) {
+    static const struct { const char* name; uint32_t caps; } regions[] = {
+        { "internal", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT },
+        { "dma", MALLOC_CAP_DMA },
+        { "psram", MALLOC_CAP_SPIRAM },
+    };
+    int n = snprintf(buf, len, "%-8s %8s %8s %8s %8s %6s %6s %5s\n",
+                     "region", "free", "used", "min", "largest", "fblks", "ablks", "frag");
+    for (const auto& r : regions) {
+        if (n >= (int)len) break;
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, r.caps);
+        uint32_t frag = info.total_free_bytes ? 100 - (uint32_t)((uint64_t)info.largest_free_block * 100 / info.total_free_bytes) : 0;
+        n += snprintf(buf + n, len - n, "%-8s %8u %8u %8u %8u %6u %6u %4lu%%\n", r.name,
+                      (unsigned)info.total_free_bytes, (unsigned)info.total_allocated_bytes,
+                      (unsigned)info.minimum_free_bytes, (unsigned)info.largest_free_block,
+                      (unsigned)info.free_blocks, (unsigned)info.allocated_blocks, (unsigned long)frag);
+    }
+
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    if (n < (int)len) {
+        n += snprintf(buf + n, len - n, "\nlvgl pool: %u total, %u free, %u max used, %u blocks, frag %u%%\n",
+                      (unsigned)mon.total_size, (unsigned)mon.free_size, (unsigned)mon.max_used,
+                      (unsigned)mon.used_cnt, (unsigned)mon.frag_pct);
+    }
+    const PanelArena* arenas[] = { &json_arena, &net_arena };
+    for (const PanelArena* a : arenas) {
+        if (n >= (int)len) break;
+        n += snprintf(buf + n, len - n, "%s arena: %u/%u used, high water %u (%lu%%), %u live, %lu fallbacks, %lu resets\n",
+                      a->name, (unsigned)a->top, (unsigned)a->size, (unsigned)a->high_water,
+                      (unsigned long)panel_arena_hwm_pct(a), (unsigned)a->live,
+                      (unsigned long)a->fallbacks, (unsigned long)a->resets);
+    }
+    return n;
+}
+
+static void diag_count_objs(lv_obj_t* obj, uint32_t* total, uint32_t* hidden) {
+    (*total)++;
+    if (lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN)) (*hidden)++;
+    uint32_t cnt = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < cnt; i++) diag_count_objs(lv_obj_get_child(obj, i), total, hidden);
+}
+
+static int diag_lvgl_line(char* buf, size_t len, const char* name, lv_obj_t* obj, bool active) {
+    if (obj == NULL) return snprintf(buf, len, "%-16s (not created)\n", name);
+    uint32_t total = 0, hidden = 0;
+    diag_count_objs(obj, &total, &hidden);
+    return snprintf(buf, len, "%-16s %6lu %6lu%s\n", name, (unsigned long)total, (unsigned long)hidden, active ? "  *" : "");
+}
+
+static int diag_lvgl(char* buf, size_t len) {
+    lv_obj_t* act = lv_screen_active();
+    int n = snprintf(buf, len, "%-16s %6s %6s\n", "screen", "objs", "hidden");
+    for (uint8_t i = 0; i < panel_screen_count && n < (int)len; i++) {
+        lv_obj_t* obj = *panel_screens[i].obj;
+        n += diag_lvgl_line(buf + n, len - n, panel_screens[i].name, obj, obj != NULL && obj == act);
+    }
+    if (n < (int)len) n += diag_lvgl_line(buf + n, len - n, "layer_top", lv_layer_top(), false);
+    if (n < (int)len) n += diag_lvgl_line(buf + n, len - n, "pool parking", obj_pool_parking, false);
+    return n;
+}
+
+static int diag_hist(char* buf, size_t len, const char* title, const TelemHist* h) {
+    int n = snprintf(buf, len, "%s: n=%lu p50=%lu p95=%lu p99=%lu max=%lu\n", title, (unsigned long)h->count,
+                     (unsigned long)telem_hist_pct(h, 50), (unsigned long)telem_hist_pct(h, 95),
+                     (unsigned long)telem_hist_pct(h, 99), (unsigned long)h->max_ms);
+    for (int ms = 0; ms < TELEM_HIST_MS && n < (int)len; ms++) {
+        if (h->bucket[ms] == 0) continue;
+        n += snprintf(buf + n, len - n, "  %s%2d ms: %u\n", ms == TELEM_HIST_MS - 1 ? ">=" : "  ", ms, h->bucket[ms]);
+    }
+    return n;
+}
+
+static int diag_frames(char* buf, size_t len) {
+    int n = diag_hist(buf, len, "render", &telem_frame);
+    if (n < (int)len) n += diag_hist(buf + n, len - n, "loop", &telem_loop);
+    return n;
+}
+
+// Builds one config, serializes it both ways and parses each DIAG_CODEC_RUNS
+// times through the json arena, the same path a config from HA takes
+static int diag_codec(char* buf, size_t len, int buttons) {
+    static const char* const rooms[] = { "Living Room", "Kitchen", "Bedroom", "Office", "Garden", "Hall" };
+    static const char* const icons[] = { "light", "power", "fan", "blinds", "lock", "tv" };
+    if (buttons <= 0 || buttons > DIAG_CODEC_MAX) buttons = DIAG_CODEC_DEF;
+
+    JsonDocument src;
+    JsonArray arr = src["buttons"].to<JsonArray>();
+    char text[40];
+    for (int i = 0; i < buttons; i++) {
+        JsonObject b = arr.add<JsonObject>();
+        snprintf(text, sizeof(text), "light.bench_%d", i);
+        b["entity"] = (char*)text;
+        snprintf(text, sizeof(text), "%s %d", rooms[i % 6], i);
+        b["name"] = (char*)text;
+        b["icon"] = icons[i % 6];
+        b["room"] = rooms[i % 6];
+        b["state"] = (i & 1) ? "ON" : "OFF";
+    }
+
+    size_t sizes[2] = { measureJson(src), measureMsgPack(src) };
+    char* bodies[2];
+    for (int f = 0; f < 2; f++) {
+        bodies[f] = (char*)hd_malloc(HT_DIAG, sizes[f] + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (bodies[0] == NULL || bodies[1] == NULL) {
+        hd_free(bodies[0]);
+        hd_free(bodies[1]);
+        return snprintf(buf, len, "out of memory\n");
+    }
+    serializeJson(src, bodies[0], sizes[0] + 1);
+    serializeMsgPack(src, bodies[1], sizes[1]);
+    src.clear();
+
+    uint32_t us[2];
+    bool ok = true;
+    for (int f = 0; f < 2; f++) {
+        uint32_t start = micros();
+        for (int r = 0; r < DIAG_CODEC_RUNS; r++) {
+            JsonDocument doc(&json_allocator);
+            if (panel_deserialize(doc, bodies[f], sizes[f])) ok = false;
+        }
+        us[f] = (micros() - start) / DIAG_CODEC_RUNS;
+    }
+    hd_free(bodies[0]);
+    hd_free(bodies[1]);
+
+    return snprintf(buf, len, "%d buttons, %d parses each\n%-8s %7s %9s\n%-8s %7u %9lu\n%-8s %7u %9lu\n"
+                    "msgpack: %lu%% of the JSON size, %lu%% of its parse time%s\n",
+                    buttons, DIAG_CODEC_RUNS, "", "bytes", "us/parse",
+                    "json", (unsigned)sizes[0], (unsigned long)us[0],
+                    "msgpack", (unsigned)sizes[1], (unsigned long)us[1],
+                    (unsigned long)(sizes[1] * 100 / sizes[0]), (unsigned long)(us[0] ? (uint64_t)us[1] * 100 / us[0] : 0),
+                    ok ? "" : "\nparse error, numbers are not valid");
+}
+
+static int diag_run(const char* cmd, char* buf, size_t len) {
+    if (strcmp(cmd, "tasks") == 0) return diag_tasks(buf, len);
+    if (strcmp(cmd, "heap") == 0) return diag_heap(buf, len);
+    if (strcmp(cmd, "lvgl") == 0) return diag_lvgl(buf, len);
+    if (strcmp(cmd, "frames") == 0) return diag_frames(buf, len);
+    if (strncmp(cmd, "codec", 5) == 0 && (cmd[5] == '\0' || cmd[5] == ' ')) {
+        return diag_codec(buf, len, cmd[5] ? atoi(cmd + 6) : DIAG_CODEC_DEF);
+    }
+    if (strncmp(cmd, "log", 3) == 0 && (cmd[3] == '\0' || cmd[3] == ' ')) {
+        return panel_log_dump(buf, len, cmd[3] ? atoi(cmd + 4) : PANEL_LOG_RECORDS);
+    }
+    if (strcmp(cmd, "crashlog") == 0) return panel_log_crash_dump(buf, len);
+    if (strcmp(cmd, "census") == 0) return heap_census(buf, len);
+    if (strcmp(cmd, "snap") == 0) return heap_snap(buf, len);
+    if (strcmp(cmd, "leaks") == 0) return heap_leaks(buf, len);
+#if PANEL_HEAP_DEBUG
+    if (strcmp(cmd, "opdiff") == 0) return snprintf(buf, len, "%s", heap_op_last[0] ? heap_op_last : "no operation yet\n");
+#endif
+    return snprintf(buf, len, "commands: tasks, heap, lvgl, census, snap, leaks, frames, codec [n], log [n], crashlog\n");
+}
+
+// --- MQTT ---
+static void diag_on_msg(const char* topic, const char* wildcard, char* payload, unsigned int len) {
+    // Trim whitespace and newlines, HA's publish dialog likes to add them
+    while (len > 0 && isspace((unsigned char)payload[len - 1])) payload[--len] = '\0';
+    while (*payload && isspace((unsigned char)*payload)) payload++;
+    snprintf(diag_pending, sizeof(diag_pending), "%s", payload);
+    diag_has_pending = true;
+}
+
+void diag_setup_routes() {
+    diag_route = mqtt_router_on(panel_topic(diag_topic, sizeof(diag_topic), "diag"), diag_on_msg);
+}
+
+void diag_topics_changed() {
+    mqtt_link_set_route_filter(diag_route, panel_topic(diag_topic, sizeof(diag_topic), "diag"));
+}
+
+static void diag_reply(const char* cmd, const char* text, int len) {
+    char chunk[DIAG_CHUNK + DIAG_CMD_LEN + 16];
+    int parts = len > 0 ? (len + DIAG_CHUNK - 1) / DIAG_CHUNK : 1;
+    panel_topic(diag_topic, sizeof(diag_topic), "diag/reply");
+    for (int p = 0; p < parts; p++) {
+        int off = p * DIAG_CHUNK;
+        int body = len - off < DIAG_CHUNK ? len - off : DIAG_CHUNK;
+        int h = snprintf(chunk, sizeof(chunk), "%s %d/%d\n", cmd, p + 1, parts);
+        if (body > 0) memcpy(chunk + h, text + off, body);
+        if (!mqtt.publish(diag_topic, (const uint8_t*)chunk, h + (body > 0 ? body : 0), false)) break;
+    }
+}
+
+// Called from loop()
+void diag_process() {
+    if (!diag_has_pending || !mqtt_link_ready()) return;
+    diag_has_pending = false;
+
+    char* buf = (char*)hd_malloc(HT_DIAG, DIAG_REPLY_MAX, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (buf == NULL) buf = (char*)hd_malloc(HT_DIAG, DIAG_REPLY_MAX);
+    if (buf == NULL) return;
+
+    int n = diag_run(diag_pending, buf, DIAG_REPLY_MAX);
+    if (n >= DIAG_REPLY_MAX) n = DIAG_REPLY_MAX - 1;
+    if (n < 0) n = 0;
+    diag_reply(diag_pending, buf, n);
+    hd_free(buf);
+}
+
+#endif
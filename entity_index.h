@@ -0,0 +1,114 @@
+#ifndef ENTITY_INDEX_H
+#define ENTITY_INDEX_H
+
+#include <lvgl.h>
+#include "string_intern.h"
+#include "entity_state.h"
+
+// --- ENTITY INDEX ---
+// One entry per configured entity, kept in config order by refresh_ui_data().
+// Maps the interned entity ID to its button, room and state entry so MQTT
+// updates and room filtering never have to search the LVGL tree. Name and icon
+// are kept too, so a new config can be diffed without reading widgets back.
+
+#define MAX_ENTITIES     512
+#define ENTITY_BUCKETS   1024  // Power of two, keep >= 2x MAX_ENTITIES
+
+struct EntityEntry {
+    const char* id;     // Interned
+    const char* name;   // Interned
+    const char* icon;   // Interned icon key ("light", "fan", ...)
+    uint32_t hash;
+    lv_obj_t* btn;      // Grid slot currently showing this entity, NULL when off-page
+    uint16_t order;     // Position in the current config
+    EntityState* state; // Shared with entity_state.h, never NULL for a valid entry
+    uint16_t room;      // Room id from room_index.h (0 = "My Home")
+    bool seen;          // Scratch flag used while diffing a new config
+};
+
+EntityEntry entity_index[MAX_ENTITIES];
+uint16_t entity_count = 0;
+uint16_t entity_buckets[ENTITY_BUCKETS];   // Entry index + 1, 0 = empty
+
+void entity_index_clear() {
+    entity_count = 0;
+    memset(entity_buckets, 0, sizeof(entity_buckets));
+}
+
+// Rebuilds the hash buckets after entries were moved or removed.
+void entity_index_reindex() {
+    memset(entity_buckets, 0, sizeof(entity_buckets));
+    for (uint16_t i = 0; i < entity_count; i++) {
+        uint32_t b = entity_index[i].hash & (ENTITY_BUCKETS - 1);
+        while (entity_buckets[b] != 0) b = (b + 1) & (ENTITY_BUCKETS - 1);
+        entity_buckets[b] = i + 1;
+    }
+}
+
+EntityEntry* entity_index_find(const char* id) {
+    if (id == NULL || entity_count == 0) return NULL;
+    uint32_t h = fnv1a(id);
+    uint32_t b = h & (ENTITY_BUCKETS - 1);
+    while (entity_buckets[b] != 0) {
+        EntityEntry* e = &entity_index[entity_buckets[b] - 1];
+        if (e->hash == h && (e->id == id || strcmp(e->id, id) == 0)) return e;
+        b = (b + 1) & (ENTITY_BUCKETS - 1);
+    }
+    return NULL;
+}
+
+// Returns the new entry, the existing one for a duplicate ID, or NULL when full.
+EntityEntry* entity_index_add(const char* id, lv_obj_t* btn, uint16_t room) {
+    EntityEntry* existing = entity_index_find(id);
+    if (existing) return existing;
+    if (entity_count >= MAX_ENTITIES) return NULL;
+
+    EntityState* st = entity_state_get(id);
+    if (st == NULL) return NULL;
+
+    EntityEntry* e = &entity_index[entity_count];
+    memset(e, 0, sizeof(*e));
+    e->id = st->id;
+    e->hash = st->hash;
+    e->btn = btn;
+    e->state = st;
+    e->room = room;
+
+    uint32_t b = e->hash & (ENTITY_BUCKETS - 1);
+    while (entity_buckets[b] != 0) b = (b + 1) & (ENTITY_BUCKETS - 1);
+    entity_buckets[b] = entity_count + 1;
+    entity_count++;
+    return e;
+}
+
+// Drops every entry whose `seen` flag is clear. `on_remove` runs first so the
+// caller can release the entry's widget.
+void entity_index_sweep(void (*on_remove)(EntityEntry*)) {
+    uint16_t w = 0;
+    for (uint16_t r = 0; r < entity_count; r++) {
+        if (!entity_index[r].seen) {
+            if (on_remove) on_remove(&entity_index[r]);
+            continue;
+        }
+        if (w != r) entity_index[w] = entity_index[r];
+        w++;
+    }
+    entity_count = w;
+    entity_index_reindex();
+}
+
+// Restores config order. Insertion sort: the index is almost always sorted already.
+void entity_index_sort() {
+    for (uint16_t i = 1; i < entity_count; i++) {
+        EntityEntry tmp = entity_index[i];
+        int j = i - 1;
+        while (j >= 0 && entity_index[j].order > tmp.order) {
+            entity_index[j + 1] = entity_index[j];
+            j--;
+        }
+        entity_index[j + 1] = tmp;
+    }
+    entity_index_reindex();
+}
+
+#endif
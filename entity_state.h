@@ -0,0 +1,147 @@
+#ifndef ENTITY_STATE_H
+#define ENTITY_STATE_H
+
+#include <Arduino.h>
+#include "string_intern.h"
+#include "panel_log.h"
+
+// --- ENTITY STATE STORE ---
+// Last known state of every entity HA has told us about, keyed by interned ID.
+// It is independent of the config and of LVGL, so state survives rebuilds and is
+// available for entities that are filtered out, off-page or not configured yet.
+// MQTT handlers write here; widgets subscribe and redraw what changed.
+// Entries are created for configured entities only and released with
+// entity_state_prune() when a new config drops them. Freed slots are reused;
+// the entries that stay never move, so EntityState pointers remain valid.
+
+#define STATE_MAX          512
+#define STATE_BUCKETS      1024   // Power of two, keep >= 2x STATE_MAX
+#define STATE_SUBSCRIBERS  4
+
+#define STATE_UNKNOWN      0xFF   // brightness / position not reported
+
+struct EntityState {
+    const char* id;          // Interned
+    uint32_t hash;
+    uint32_t last_changed;   // millis() of the last change
+    uint32_t seq;            // Global change counter at the last change
+    uint8_t brightness;      // 0-255, STATE_UNKNOWN if not reported
+    uint8_t position;        // 0-100 (covers), STATE_UNKNOWN if not reported
+    bool on;
+    bool known;              // False until HA (or the config) reported a state
+};
+
+typedef void (*entity_state_cb_t)(const EntityState* s, void* ctx);
+
+struct StateSubscriber {
+    entity_state_cb_t cb;
+    void* ctx;
+};
+
+EntityState entity_states[STATE_MAX];
+uint16_t entity_state_count = 0;                // Slots in use or freed, see entity_state_free
+uint16_t entity_state_buckets[STATE_BUCKETS];   // Entry index + 1, 0 = empty
+uint16_t entity_state_free = 0;                 // Freed slots below entity_state_count (id == NULL)
+uint32_t entity_state_seq = 0;
+StateSubscriber entity_state_subs[STATE_SUBSCRIBERS];
+uint8_t entity_state_sub_count = 0;
+
+bool entity_state_subscribe(entity_state_cb_t cb, void* ctx = NULL) {
+    if (entity_state_sub_count >= STATE_SUBSCRIBERS) return false;
+    entity_state_subs[entity_state_sub_count].cb = cb;
+    entity_state_subs[entity_state_sub_count].ctx = ctx;
+    entity_state_sub_count++;
+    return true;
+}
+
+EntityState* entity_state_find(const char* id) {
+    if (id == NULL || entity_state_count == 0) return NULL;
+    uint32_t h = fnv1a(id);
+    uint32_t b = h & (STATE_BUCKETS - 1);
+    while (entity_state_buckets[b] != 0) {
+        EntityState* s = &entity_states[entity_state_buckets[b] - 1];
+        if (s->hash == h && (s->id == id || strcmp(s->id, id) == 0)) return s;
+        b = (b + 1) & (STATE_BUCKETS - 1);
+    }
+    return NULL;
+}
+
+static EntityState* entity_state_claim() {
+    if (entity_state_free > 0) {
+        for (uint16_t i = 0; i < entity_state_count; i++) {
+            if (entity_states[i].id == NULL) { entity_state_free--; return &entity_states[i]; }
+        }
+    }
+    if (entity_state_count >= STATE_MAX) return NULL;
+    return &entity_states[entity_state_count++];
+}
+
+// Returns the entry for `id`, creating an unknown one if needed. NULL when full.
+EntityState* entity_state_get(const char* id) {
+    EntityState* s = entity_state_find(id);
+    if (s) return s;
+    if (id == NULL) return NULL;
+    if (entity_state_count - entity_state_free >= STATE_MAX) {
+        LOG_E("STATE: Store full (%u entries), %s not tracked", (unsigned)STATE_MAX, id);
+        return NULL;
+    }
+
+    uint32_t h;
+    const char* interned = intern_string(id, &h);
+    if (interned == NULL) return NULL;
+
+    s = entity_state_claim();
+    memset(s, 0, sizeof(*s));
+    s->id = interned;
+    s->hash = h;
+    s->brightness = STATE_UNKNOWN;
+    s->position = STATE_UNKNOWN;
+
+    uint32_t b = h & (STATE_BUCKETS - 1);
+    while (entity_state_buckets[b] != 0) b = (b + 1) & (STATE_BUCKETS - 1);
+    entity_state_buckets[b] = (s - entity_states) + 1;
+    return s;
+}
+
+// Releases every entry `keep` rejects, e.g. entities the new config dropped.
+void entity_state_prune(bool (*keep)(const EntityState* s)) {
+    memset(entity_state_buckets, 0, sizeof(entity_state_buckets));
+    entity_state_free = 0;
+    for (uint16_t i = 0; i < entity_state_count; i++) {
+        EntityState* s = &entity_states[i];
+        if (s->id != NULL && !keep(s)) s->id = NULL;
+        if (s->id == NULL) { entity_state_free++; continue; }
+        uint32_t b = s->hash & (STATE_BUCKETS - 1);
+        while (entity_state_buckets[b] != 0) b = (b + 1) & (STATE_BUCKETS - 1);
+        entity_state_buckets[b] = i + 1;
+    }
+    // Trailing free slots go back to the append area
+    while (entity_state_count > 0 && entity_states[entity_state_count - 1].id == NULL) {
+        entity_state_count--;
+        entity_state_free--;
+    }
+}
+
+// Writes a state and notifies subscribers if anything changed. Pass STATE_UNKNOWN
+// for brightness/position to leave them untouched.
+bool entity_state_set(const char* id, bool on, uint8_t brightness = STATE_UNKNOWN, uint8_t position = STATE_UNKNOWN) {
+    EntityState* s = entity_state_get(id);
+    if (s == NULL) return false;
+
+    bool changed = !s->known || s->on != on;
+    if (brightness != STATE_UNKNOWN && s->brightness != brightness) { s->brightness = brightness; changed = true; }
+    if (position != STATE_UNKNOWN && s->position != position) { s->position = position; changed = true; }
+    if (!changed) return false;
+
+    s->on = on;
+    s->known = true;
+    s->last_changed = millis();
+    s->seq = ++entity_state_seq;
+
+    for (uint8_t i = 0; i < entity_state_sub_count; i++) {
+        entity_state_subs[i].cb(s, entity_state_subs[i].ctx);
+    }
+    return true;
+}
+
+#endif
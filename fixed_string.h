@@ -0,0 +1,88 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+#include <stdarg.h>
+
+// --- FIXED-CAPACITY STRINGS ---
+// A drop-in for Arduino String on paths that run every frame or every second:
+// the characters live inside the object (usually on the stack), so building a
+// label never touches the heap. Text that does not fit is truncated, never
+// overflows, and `truncated()` reports it.
+//
+//   FixedString<24> s;
+//   s.appendf("%.0f", current_temp).append("°");
+//   lv_label_set_text(label, s.c_str());
+
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { clear(); }
+    FixedString(const char* s) { clear(); append(s); }
+
+    void clear() {
+        buf_[0] = '\0';
+        len_ = 0;
+        truncated_ = false;
+    }
+
+    FixedString& set(const char* s) {
+        clear();
+        return append(s);
+    }
+
+    FixedString& append(const char* s) {
+        if (s == NULL) return *this;
+        while (*s) {
+            if (len_ >= N - 1) { truncated_ = true; break; }
+            buf_[len_++] = *s++;
+        }
+        buf_[len_] = '\0';
+        return *this;
+    }
+
+    // Appends at most `n` bytes of `s`
+    FixedString& append(const char* s, size_t n) {
+        if (s == NULL) return *this;
+        for (size_t i = 0; i < n && s[i]; i++) {
+            if (len_ >= N - 1) { truncated_ = true; break; }
+            buf_[len_++] = s[i];
+        }
+        buf_[len_] = '\0';
+        return *this;
+    }
+
+    FixedString& append(char c) {
+        if (len_ >= N - 1) truncated_ = true;
+        else { buf_[len_++] = c; buf_[len_] = '\0'; }
+        return *this;
+    }
+
+    FixedString& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf_ + len_, N - len_, fmt, ap);
+        va_end(ap);
+        if (n < 0) { buf_[len_] = '\0'; return *this; }
+        if ((size_t)n >= N - len_) {
+            truncated_ = true;
+            len_ = N - 1;
+        } else {
+            len_ += n;
+        }
+        return *this;
+    }
+
+    const char* c_str() const { return buf_; }
+    size_t length() const { return len_; }
+    static constexpr size_t capacity() { return N - 1; }
+    bool truncated() const { return truncated_; }
+    bool equals(const char* s) const { return s != NULL && strcmp(buf_, s) == 0; }
+
+private:
+    char buf_[N];
+    size_t len_;
+    bool truncated_;
+};
+
+#endif
@@ -0,0 +1,325 @@
+#ifndef HEAP_DEBUG_H
+#define HEAP_DEBUG_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include <esp_heap_caps.h>
+#include "panel_log.h"
+#include "panel_arena.h"
+#include "obj_pool.h"
+
+// --- HEAP ACCOUNTING ---
+// A snapshot records free memory and block counts per region, the LVGL pool,
+// arena usage and an LVGL object census (objects per screen and widget type).
+// Comparing two snapshots shows what an operation left behind. Snapshots and
+// the census are always available through diag ("census", "snap", "leaks").
+//
+// Building with PANEL_HEAP_DEBUG 1 adds:
+//   - allocation tags: hd_malloc()/hd_free() keep a live count and byte total
+//     per call site tag (release builds map them straight to the heap)
+//   - automatic diffs around operations marked with HEAP_DEBUG_BEGIN/END; an
+//     operation that grows anything is logged, and the last diff is kept for
+//     diag "opdiff"
+
+#ifndef PANEL_HEAP_DEBUG
+#define PANEL_HEAP_DEBUG   0
+#endif
+
+#define PANEL_SCREENS      16
+#define CENSUS_ROOTS       (PANEL_SCREENS + 3)   // Registered screens, layer_top, layer_sys, pool parking
+#define HEAP_DIFF_MAX      1024
+
+enum HeapTag : uint8_t {
+    HT_LAYOUT,          // Parsed button list while a config is applied
+    HT_LAYOUT_CACHE,    // Flash cache file bodies
+    HT_DIAG,            // Diagnostic reply buffers
+    HT_COUNT
+};
+
+static const char* const heap_tag_names[HT_COUNT] = { "layout", "layout_cache", "diag" };
+
+struct PanelScreen {
+    const char* name;
+    lv_obj_t** obj;        // Pointer to the global, so screens created later are picked up
+};
+
+PanelScreen panel_screens[PANEL_SCREENS];
+uint8_t panel_screen_count = 0;
+
+void panel_register_screen(const char* name, lv_obj_t** obj) {
+    if (panel_screen_count >= PANEL_SCREENS) return;
+    panel_screens[panel_screen_count].name = name;
+    panel_screens[panel_screen_count].obj = obj;
+    panel_screen_count++;
+}
+
+// --- TAGGED ALLOCATIONS ---
+#if PANEL_HEAP_DEBUG
+struct HeapTagHeader {
+    uint32_t size;
+    uint8_t tag;
+    uint8_t reserved[3];
+};
+
+int32_t heap_tag_count[HT_COUNT];
+int32_t heap_tag_bytes[HT_COUNT];
+
+void* hd_malloc(HeapTag tag, size_t n, uint32_t caps = MALLOC_CAP_DEFAULT) {
+    HeapTagHeader* h = (HeapTagHeader*)heap_caps_malloc(sizeof(HeapTagHeader) + n, caps);
+    if (h == NULL) return NULL;
+    h->size = (uint32_t)n;
+    h->tag = tag;
+    heap_tag_count[tag]++;
+    heap_tag_bytes[tag] += n;
+    return h + 1;
+}
+
+void hd_free(void* p) {
+    if (p == NULL) return;
+    HeapTagHeader* h = (HeapTagHeader*)p - 1;
+    if (h->tag < HT_COUNT) {
+        heap_tag_count[h->tag]--;
+        heap_tag_bytes[h->tag] -= h->size;
+    }
+    free(h);
+}
+#else
+inline void* hd_malloc(HeapTag tag, size_t n, uint32_t caps = MALLOC_CAP_DEFAULT) { return heap_caps_malloc(n, caps); }
+inline void hd_free(void* p) { free(p); }
+#endif
+
+// --- LVGL CENSUS ---
+struct CensusType {
+    const lv_obj_class_t* cls;
+    const char* name;
+};
+
+static const CensusType census_types[] = {
+    { &lv_obj_class, "obj" },           { &lv_label_class, "label" },
+    { &lv_button_class, "button" },     { &lv_image_class, "image" },
+    { &lv_spinner_class, "spinner" },   { &lv_arc_class, "arc" },
+    { &lv_bar_class, "bar" },           { &lv_slider_class, "slider" },
+    { &lv_switch_class, "switch" },     { &lv_checkbox_class, "checkbox" },
+    { &lv_textarea_class, "textarea" }, { &lv_dropdown_class, "dropdown" },
+    { &lv_roller_class, "roller" },     { &lv_keyboard_class, "keyboard" },
+    { &lv_list_class, "list" },         { &lv_list_button_class, "list_button" },
+    { &lv_list_text_class, "list_text" }, { &lv_msgbox_class, "msgbox" },
+};
+
+#define CENSUS_KNOWN  (sizeof(census_types) / sizeof(census_types[0]))
+#define CENSUS_TYPES  (CENSUS_KNOWN + 1)   // The last column counts everything else
+
+struct HeapSnapshot {
+    uint32_t ms;
+    uint32_t heap_free[2];     // Internal, PSRAM
+    uint32_t heap_blocks[2];
+    uint32_t lv_used;
+    uint32_t lv_blocks;
+    uint16_t arena_live[2];    // json, net
+    uint16_t objs[CENSUS_ROOTS][CENSUS_TYPES];
+#if PANEL_HEAP_DEBUG
+    int32_t tag_count[HT_COUNT];
+    int32_t tag_bytes[HT_COUNT];
+#endif
+};
+
+static uint8_t census_type_of(const lv_obj_t* obj) {
+    const lv_obj_class_t* cls = lv_obj_get_class(obj);
+    for (uint8_t i = 0; i < CENSUS_KNOWN; i++) {
+        if (census_types[i].cls == cls) return i;
+    }
+    return CENSUS_KNOWN;
+}
+
+static void census_walk(lv_obj_t* obj, uint16_t* row) {
+    uint8_t t = census_type_of(obj);
+    if (row[t] < UINT16_MAX) row[t]++;
+    uint32_t cnt = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < cnt; i++) census_walk(lv_obj_get_child(obj, i), row);
+}
+
+static const char* census_root_name(uint8_t r) {
+    if (r < panel_screen_count) return panel_screens[r].name;
+    if (r == PANEL_SCREENS) return "layer_top";
+    if (r == PANEL_SCREENS + 1) return "layer_sys";
+    if (r == PANEL_SCREENS + 2) return "pool parking";
+    return NULL;
+}
+
+static lv_obj_t* census_root(uint8_t r) {
+    if (r < panel_screen_count) return *panel_screens[r].obj;
+    if (r == PANEL_SCREENS) return lv_layer_top();
+    if (r == PANEL_SCREENS + 1) return lv_layer_sys();
+    if (r == PANEL_SCREENS + 2) return obj_pool_parking;
+    return NULL;
+}
+
+void heap_snapshot(HeapSnapshot* s) {
+    memset(s, 0, sizeof(*s));
+    s->ms = millis();
+    static const uint32_t caps[2] = { MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM };
+    for (int i = 0; i < 2; i++) {
+        multi_heap_info_t info;
+        heap_caps_get_info(&info, caps[i]);
+        s->heap_free[i] = info.total_free_bytes;
+        s->heap_blocks[i] = info.allocated_blocks;
+    }
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    s->lv_used = mon.total_size - mon.free_size;
+    s->lv_blocks = mon.used_cnt;
+    s->arena_live[0] = json_arena.live;
+    s->arena_live[1] = net_arena.live;
+    for (uint8_t r = 0; r < CENSUS_ROOTS; r++) {
+        lv_obj_t* root = census_root(r);
+        if (root) census_walk(root, s->objs[r]);
+    }
+#if PANEL_HEAP_DEBUG
+    memcpy(s->tag_count, heap_tag_count, sizeof(heap_tag_count));
+    memcpy(s->tag_bytes, heap_tag_bytes, sizeof(heap_tag_bytes));
+#endif
+}
+
+// Snapshots are large enough to keep out of internal RAM
+static HeapSnapshot* heap_snapshot_alloc() {
+    HeapSnapshot* s = (HeapSnapshot*)heap_caps_malloc(sizeof(HeapSnapshot), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return s ? s : (HeapSnapshot*)malloc(sizeof(HeapSnapshot));
+}
+
+// Object counts per screen and type, leaving out empty cells
+int heap_census(char* buf, size_t len) {
+    HeapSnapshot* s = heap_snapshot_alloc();
+    if (s == NULL) return snprintf(buf, len, "out of memory\n");
+    heap_snapshot(s);
+    int n = 0;
+    for (uint8_t r = 0; r < CENSUS_ROOTS && n < (int)len; r++) {
+        const char* name = census_root_name(r);
+        if (name == NULL) continue;
+        uint32_t total = 0;
+        for (uint8_t t = 0; t < CENSUS_TYPES; t++) total += s->objs[r][t];
+        if (total == 0) continue;
+        n += snprintf(buf + n, len - n, "%s: %lu\n", name, (unsigned long)total);
+        for (uint8_t t = 0; t < CENSUS_TYPES && n < (int)len; t++) {
+            if (s->objs[r][t] == 0) continue;
+            n += snprintf(buf + n, len - n, "  %-12s %5u\n", t < CENSUS_KNOWN ? census_types[t].name : "other",
+                          s->objs[r][t]);
+        }
+    }
+    free(s);
+    return n;
+}
+
+// Writes what changed from `a` to `b`. Returns the text length; *grew is set if anything increased.
+int heap_snapshot_diff(const HeapSnapshot* a, const HeapSnapshot* b, char* buf, size_t len, bool* grew) {
+    *grew = false;
+    int n = snprintf(buf, len, "over %lu ms\n", (unsigned long)(b->ms - a->ms));
+    static const char* const regions[2] = { "internal", "psram" };
+    for (int i = 0; i < 2 && n < (int)len; i++) {
+        int32_t blocks = (int32_t)(b->heap_blocks[i] - a->heap_blocks[i]);
+        int32_t used = (int32_t)(a->heap_free[i] - b->heap_free[i]);
+        if (blocks == 0 && used == 0) continue;
+        if (blocks > 0) *grew = true;
+        n += snprintf(buf + n, len - n, "%s heap: %+ld bytes, %+ld blocks\n", regions[i], (long)used, (long)blocks);
+    }
+    if (n < (int)len && (b->lv_used != a->lv_used || b->lv_blocks != a->lv_blocks)) {
+        if (b->lv_blocks > a->lv_blocks) *grew = true;
+        n += snprintf(buf + n, len - n, "lvgl pool: %+ld bytes, %+ld blocks\n",
+                      (long)(int32_t)(b->lv_used - a->lv_used), (long)(int32_t)(b->lv_blocks - a->lv_blocks));
+    }
+    static const char* const arenas[2] = { "json", "net" };
+    for (int i = 0; i < 2 && n < (int)len; i++) {
+        if (b->arena_live[i] == a->arena_live[i]) continue;
+        if (b->arena_live[i] > a->arena_live[i]) *grew = true;
+        n += snprintf(buf + n, len - n, "%s arena: %+d live blocks\n", arenas[i], b->arena_live[i] - a->arena_live[i]);
+    }
+#if PANEL_HEAP_DEBUG
+    for (int t = 0; t < HT_COUNT && n < (int)len; t++) {
+        if (b->tag_count[t] == a->tag_count[t] && b->tag_bytes[t] == a->tag_bytes[t]) continue;
+        if (b->tag_count[t] > a->tag_count[t]) *grew = true;
+        n += snprintf(buf + n, len - n, "tag %s: %+ld blocks, %+ld bytes\n", heap_tag_names[t],
+                      (long)(b->tag_count[t] - a->tag_count[t]), (long)(b->tag_bytes[t] - a->tag_bytes[t]));
+    }
+#endif
+    // Objects moving between screens (e.g. out of the pool parking) are not growth, only type totals count
+    for (uint8_t t = 0; t < CENSUS_TYPES; t++) {
+        int d = 0;
+        for (uint8_t r = 0; r < CENSUS_ROOTS; r++) d += (int)b->objs[r][t] - (int)a->objs[r][t];
+        if (d > 0) *grew = true;
+    }
+    for (uint8_t r = 0; r < CENSUS_ROOTS && n < (int)len; r++) {
+        for (uint8_t t = 0; t < CENSUS_TYPES && n < (int)len; t++) {
+            int d = (int)b->objs[r][t] - (int)a->objs[r][t];
+            if (d == 0) continue;
+            n += snprintf(buf + n, len - n, "%s: %+d %s\n", census_root_name(r) ? census_root_name(r) : "?", d,
+                          t < CENSUS_KNOWN ? census_types[t].name : "other");
+        }
+    }
+    return n;
+}
+
+// --- BASELINE (diag "snap" / "leaks") ---
+// Both snapshots are allocated by "snap", so taking the second one does not itself show up as growth.
+HeapSnapshot* heap_baseline = NULL;
+HeapSnapshot* heap_current = NULL;
+
+int heap_snap(char* buf, size_t len) {
+    if (heap_baseline == NULL) heap_baseline = heap_snapshot_alloc();
+    if (heap_current == NULL) heap_current = heap_snapshot_alloc();
+    if (heap_baseline == NULL || heap_current == NULL) return snprintf(buf, len, "out of memory\n");
+    heap_snapshot(heap_baseline);
+    return snprintf(buf, len, "baseline taken\n");
+}
+
+int heap_leaks(char* buf, size_t len) {
+    if (heap_baseline == NULL || heap_current == NULL) return snprintf(buf, len, "no baseline, send \"snap\" first\n");
+    heap_snapshot(heap_current);
+    bool grew;
+    int n = heap_snapshot_diff(heap_baseline, heap_current, buf, len, &grew);
+    if (n < (int)len) n += snprintf(buf + n, len - n, grew ? "growth since baseline\n" : "no growth since baseline\n");
+    return n;
+}
+
+// --- OPERATION DIFFS (PANEL_HEAP_DEBUG) ---
+#if PANEL_HEAP_DEBUG
+HeapSnapshot* heap_op_before = NULL;
+HeapSnapshot* heap_op_after = NULL;
+const char* heap_op_name = NULL;      // Operation in progress
+char heap_op_last[HEAP_DIFF_MAX];     // Diff of the last finished operation
+
+// Operations do not nest; a begin while one is open is ignored, and so is its end.
+void heap_debug_begin(const char* op) {
+    if (heap_op_name != NULL) return;
+    if (heap_op_before == NULL) heap_op_before = heap_snapshot_alloc();
+    if (heap_op_after == NULL) heap_op_after = heap_snapshot_alloc();
+    if (heap_op_before == NULL || heap_op_after == NULL) return;
+    heap_snapshot(heap_op_before);
+    heap_op_name = op;
+}
+
+void heap_debug_end(const char* op) {
+    if (heap_op_name == NULL || strcmp(heap_op_name, op) != 0) return;
+    const HeapSnapshot* a = heap_op_before;
+    HeapSnapshot* b = heap_op_after;
+    heap_snapshot(b);
+    int n = snprintf(heap_op_last, sizeof(heap_op_last), "%s ", heap_op_name);
+    bool grew;
+    heap_snapshot_diff(a, b, heap_op_last + n, sizeof(heap_op_last) - n, &grew);
+    if (grew) {
+        int32_t objs = 0;
+        for (uint8_t r = 0; r < CENSUS_ROOTS; r++) {
+            for (uint8_t t = 0; t < CENSUS_TYPES; t++) objs += (int)b->objs[r][t] - (int)a->objs[r][t];
+        }
+        LOG_W("Heap: %s grew (%ld objects, %ld internal blocks), see diag opdiff", heap_op_name, (long)objs,
+              (long)(int32_t)(b->heap_blocks[0] - a->heap_blocks[0]));
+    }
+    heap_op_name = NULL;
+}
+
+#define HEAP_DEBUG_BEGIN(op)  heap_debug_begin(op)
+#define HEAP_DEBUG_END(op)    heap_debug_end(op)
+#else
+#define HEAP_DEBUG_BEGIN(op)  do {} while (0)
+#define HEAP_DEBUG_END(op)    do {} while (0)
+#endif
+
+#endif
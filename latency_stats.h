@@ -0,0 +1,209 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <PubSubClient.h>
+#include "mqtt_router.h"
+#include "mqtt_link.h"
+
+extern PubSubClient mqtt;
+
+// --- COMMAND LATENCY ---
+// Every command is timed from the tap that set its target to the state update
+// from HA that confirms it. The total is split into stages so a slow panel can
+// be told apart from a slow broker or a slow HA:
+//   panel     tap -> publish (includes coalescing and waiting for MQTT)
+//   roundtrip publish -> confirming state update (broker + HA + broker)
+//   broker    panel -> broker -> panel, from a periodic self-addressed ping
+// Histograms use log2 millisecond buckets, so percentiles are upper bounds.
+
+#define LAT_BUCKETS         14      // Last bucket collects everything >= 4096 ms
+#define LAT_TRACKED         32      // Entities with their own stats
+#define LAT_PING_MS         30000
+#define LAT_PUBLISH_MS      60000
+
+struct LatencyHist {
+    uint16_t bucket[LAT_BUCKETS];   // Bucket b holds values with b significant bits
+    uint32_t count;
+    uint32_t sum_ms;
+    uint32_t max_ms;
+};
+
+struct EntityLatency {
+    const char* id;                 // Interned, NULL = free slot
+    uint16_t count;
+    uint32_t sum_ms;
+    uint32_t max_ms;
+    uint32_t last_ms;
+};
+
+LatencyHist lat_total;
+LatencyHist lat_panel;
+LatencyHist lat_roundtrip;
+LatencyHist lat_broker;
+EntityLatency lat_entities[LAT_TRACKED];
+
+bool lat_dirty = false;             // New samples since the last publish
+uint32_t lat_last_ping_ms = 0;
+uint32_t lat_last_publish_ms = 0;
+int lat_route_ping = -1;
+char lat_topic[64];
+char lat_payload[3072];
+
+void latency_hist_add(LatencyHist* h, uint32_t ms) {
+    uint8_t b = 0;
+    while (b < LAT_BUCKETS - 1 && (ms >> b) != 0) b++;
+    if (h->bucket[b] < UINT16_MAX) h->bucket[b]++;
+    h->count++;
+    h->sum_ms += ms;
+    if (ms > h->max_ms) h->max_ms = ms;
+    lat_dirty = true;
+}
+
+// Upper bound of the bucket holding the pct-th percentile, capped at the max seen
+uint32_t latency_hist_percentile(const LatencyHist* h, uint8_t pct) {
+    if (h->count == 0) return 0;
+    uint32_t want = (h->count * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < LAT_BUCKETS; b++) {
+        seen += h->bucket[b];
+        if (seen >= want) {
+            uint32_t upper = (b == 0) ? 0 : ((1UL << b) - 1);
+            return (b == LAT_BUCKETS - 1 || upper > h->max_ms) ? h->max_ms : upper;
+        }
+    }
+    return h->max_ms;
+}
+
+uint32_t latency_hist_avg(const LatencyHist* h) {
+    return h->count ? h->sum_ms / h->count : 0;
+}
+
+// Finds or claims the slot for `id`. When full, the entity with the fewest samples is replaced.
+static EntityLatency* latency_entity(const char* id) {
+    EntityLatency* victim = &lat_entities[0];
+    for (int i = 0; i < LAT_TRACKED; i++) {
+        EntityLatency* e = &lat_entities[i];
+        if (e->id == id) return e;
+        if (e->id == NULL) { victim = e; break; }
+        if (e->count < victim->count) victim = e;
+    }
+    memset(victim, 0, sizeof(*victim));
+    victim->id = id;
+    return victim;
+}
+
+// Command left the panel. `tap_ms` is the tap that set the command's target.
+void latency_record_publish(uint32_t tap_ms, uint32_t now) {
+    latency_hist_add(&lat_panel, now - tap_ms);
+}
+
+// HA reported the state a sent command asked for (from cmd_queue_on_report, for every report).
+void latency_record_confirm(const char* id, uint32_t tap_ms, uint32_t sent_ms, uint32_t now) {
+    uint32_t total = now - tap_ms;
+    latency_hist_add(&lat_roundtrip, now - sent_ms);
+    latency_hist_add(&lat_total, total);
+
+    EntityLatency* e = latency_entity(id);
+    if (e->count < UINT16_MAX) e->count++;
+    e->sum_ms += total;
+    e->last_ms = total;
+    if (total > e->max_ms) e->max_ms = total;
+}
+
+// --- BROKER PING ---
+// The payload is our own millis() at publish time, so no state is kept per ping.
+static void latency_on_ping_msg(const char*, const char*, char* payload, unsigned int) {
+    char* end = NULL;
+    uint32_t sent = strtoul(payload, &end, 10);
+    if (end == payload) return;
+    uint32_t rtt = millis() - sent;
+    if (rtt <= LAT_PING_MS) latency_hist_add(&lat_broker, rtt);
+}
+
+void latency_setup_routes() {
+    lat_route_ping = mqtt_router_on(panel_topic(lat_topic, sizeof(lat_topic), "ping"), latency_on_ping_msg);
+}
+
+// Call after the device id changed so the ping follows the new topic.
+void latency_topics_changed() {
+    mqtt_link_set_route_filter(lat_route_ping, panel_topic(lat_topic, sizeof(lat_topic), "ping"));
+}
+
+// --- REPORTING ---
+static int latency_append_hist(char* buf, size_t len, const char* name, const LatencyHist* h) {
+    return snprintf(buf, len, "\"%s\":{\"n\":%lu,\"avg\":%lu,\"p50\":%lu,\"p95\":%lu,\"max\":%lu},", name,
+                    (unsigned long)h->count, (unsigned long)latency_hist_avg(h),
+                    (unsigned long)latency_hist_percentile(h, 50), (unsigned long)latency_hist_percentile(h, 95),
+                    (unsigned long)h->max_ms);
+}
+
+static bool latency_publish() {
+    size_t cap = sizeof(lat_payload);
+    int n = snprintf(lat_payload, cap, "{");
+    n += latency_append_hist(lat_payload + n, cap - n, "total", &lat_total);
+    n += latency_append_hist(lat_payload + n, cap - n, "panel", &lat_panel);
+    n += latency_append_hist(lat_payload + n, cap - n, "roundtrip", &lat_roundtrip);
+    n += latency_append_hist(lat_payload + n, cap - n, "broker", &lat_broker);
+    n += snprintf(lat_payload + n, cap - n, "\"entities\":[");
+
+    bool first = true;
+    for (int i = 0; i < LAT_TRACKED && lat_entities[i].id != NULL; i++) {
+        const EntityLatency* e = &lat_entities[i];
+        char item[160];
+        int m = snprintf(item, sizeof(item), "%s{\"id\":\"%s\",\"n\":%u,\"avg\":%lu,\"max\":%lu,\"last\":%lu}",
+                         first ? "" : ",", e->id, e->count, (unsigned long)(e->sum_ms / e->count),
+                         (unsigned long)e->max_ms, (unsigned long)e->last_ms);
+        if (m <= 0 || m >= (int)sizeof(item) || n + m + 3 >= (int)cap) break;
+        memcpy(lat_payload + n, item, m);
+        n += m;
+        first = false;
+    }
+    n += snprintf(lat_payload + n, cap - n, "]}");
+    if (n >= (int)cap) return false;
+
+    panel_topic(lat_topic, sizeof(lat_topic), "latency");
+    return mqtt.publish(lat_topic, (const uint8_t*)lat_payload, n, false);
+}
+
+// Called from loop(): sends the broker ping and the periodic report.
+void latency_process() {
+    if (!mqtt_link_ready()) return;
+    uint32_t now = millis();
+
+    if (lat_last_ping_ms == 0 || now - lat_last_ping_ms >= LAT_PING_MS) {
+        lat_last_ping_ms = now;
+        char stamp[12];
+        snprintf(stamp, sizeof(stamp), "%lu", (unsigned long)now);
+        mqtt.publish(panel_topic(lat_topic, sizeof(lat_topic), "ping"), stamp);
+    }
+
+    if (lat_dirty && now - lat_last_publish_ms >= LAT_PUBLISH_MS) {
+        lat_last_publish_ms = now;
+        if (latency_publish()) lat_dirty = false;
+    }
+}
+
+// Summary for the status screen
+int latency_format(char* buf, size_t len) {
+    const struct { const char* label; const LatencyHist* h; } rows[] = {
+        { "Tap>HA", &lat_total }, { "Panel", &lat_panel }, { "HA", &lat_roundtrip }, { "Broker", &lat_broker },
+    };
+    int n = snprintf(buf, len, "\nLATENCY (p50/p95/max ms):\n");
+    for (const auto& r : rows) {
+        if (n >= (int)len) break;
+        n += snprintf(buf + n, len - n, "%s: %lu/%lu/%lu (n=%lu)\n", r.label,
+                      (unsigned long)latency_hist_percentile(r.h, 50), (unsigned long)latency_hist_percentile(r.h, 95),
+                      (unsigned long)r.h->max_ms, (unsigned long)r.h->count);
+    }
+
+    const EntityLatency* slowest = NULL;
+    for (int i = 0; i < LAT_TRACKED && lat_entities[i].id != NULL; i++) {
+        if (slowest == NULL || lat_entities[i].max_ms > slowest->max_ms) slowest = &lat_entities[i];
+    }
+    if (slowest && n < (int)len) {
+        n += snprintf(buf + n, len - n, "Slowest: %s %lu ms\n", slowest->id, (unsigned long)slowest->max_ms);
+    }
+    return n;
+}
+
+#endif
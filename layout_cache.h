@@ -0,0 +1,158 @@
+#ifndef LAYOUT_CACHE_H
+#define LAYOUT_CACHE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "panel_hash.h"
+#include "panel_log.h"
+#include "heap_debug.h"
+#include "layout_index.h"
+
+// --- LAYOUT CACHE ---
+// The last applied button layout is kept on the "spiffs" partition in a flat
+// binary form, so the grid can be built in setup() before WiFi or MQTT are up.
+// The file carries the FNV-1a hash of the JSON it came from; a retained config
+// with the same hash is not applied again.
+//
+// File: LayoutCacheHeader, `count` LayoutCacheEntry records, then a block of
+// NUL-terminated strings the entries point into by offset.
+
+#define LAYOUT_CACHE_PATH     "/layout.bin"
+#define LAYOUT_CACHE_TMP      "/layout.tmp"
+#define LAYOUT_CACHE_MAGIC    0x31594C50UL   // "PLY1"
+#define LAYOUT_CACHE_VERSION  1
+
+struct LayoutCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t config_hash;
+    uint32_t strings_len;
+    uint32_t checksum;     // FNV-1a over entries and strings
+};
+
+struct LayoutCacheEntry {
+    uint32_t entity;
+    uint32_t name;
+    uint32_t icon;
+    uint32_t room;
+    uint8_t on;
+    uint8_t reserved[3];
+};
+
+bool layout_cache_mounted = false;
+
+bool layout_cache_begin() {
+    if (!layout_cache_mounted) {
+        layout_cache_mounted = LittleFS.begin(true);
+        if (!layout_cache_mounted) LOG_E("Layout cache: LittleFS mount failed");
+    }
+    return layout_cache_mounted;
+}
+
+static size_t layout_cache_strlen(const char* s) {
+    return s ? strlen(s) + 1 : 1;
+}
+
+// Writes `items` to flash. Goes through a temp file so a power cut never leaves a torn cache.
+bool layout_cache_save(uint32_t config_hash, const LayoutItem* items, uint16_t count) {
+    if (!layout_cache_begin()) return false;
+
+    size_t strings_len = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        strings_len += layout_cache_strlen(items[i].entity) + layout_cache_strlen(items[i].name) +
+                       layout_cache_strlen(items[i].icon) + layout_cache_strlen(items[i].room);
+    }
+    size_t body_len = count * sizeof(LayoutCacheEntry) + strings_len;
+    uint8_t* body = (uint8_t*)hd_malloc(HT_LAYOUT_CACHE, body_len ? body_len : 1);
+    if (body == NULL) return false;
+
+    LayoutCacheEntry* entries = (LayoutCacheEntry*)body;
+    char* strings = (char*)(body + count * sizeof(LayoutCacheEntry));
+    uint32_t off = 0;
+    auto put = [&](const char* s) -> uint32_t {
+        uint32_t at = off;
+        size_t n = layout_cache_strlen(s);
+        if (s) memcpy(strings + off, s, n);
+        else strings[off] = '\0';
+        off += n;
+        return at;
+    };
+    for (uint16_t i = 0; i < count; i++) {
+        memset(&entries[i], 0, sizeof(entries[i]));
+        entries[i].entity = put(items[i].entity);
+        entries[i].name = put(items[i].name);
+        entries[i].icon = put(items[i].icon);
+        entries[i].room = put(items[i].room);
+        entries[i].on = items[i].on;
+    }
+
+    LayoutCacheHeader hdr = { LAYOUT_CACHE_MAGIC, LAYOUT_CACHE_VERSION, count, config_hash,
+                              (uint32_t)strings_len, fnv1a_n((const char*)body, body_len) };
+
+    File f = LittleFS.open(LAYOUT_CACHE_TMP, "w");
+    bool ok = f && f.write((const uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) && f.write(body, body_len) == body_len;
+    if (f) f.close();
+    hd_free(body);
+
+    ok = ok && LittleFS.rename(LAYOUT_CACHE_TMP, LAYOUT_CACHE_PATH);
+    LOG_AT(ok ? PANEL_LOG_INFO : PANEL_LOG_ERROR, "Layout cache: %s %u buttons (%u bytes)",
+           ok ? "saved" : "FAILED to save", count, (unsigned)(sizeof(hdr) + body_len));
+    return ok;
+}
+
+// Loads the cache. On success `*items_out` is a single allocation holding the
+// items and the strings they point to; release it with hd_free().
+bool layout_cache_load(LayoutItem** items_out, uint16_t* count_out, uint32_t* hash_out) {
+    *items_out = NULL;
+    if (!layout_cache_begin() || !LittleFS.exists(LAYOUT_CACHE_PATH)) return false;
+
+    File f = LittleFS.open(LAYOUT_CACHE_PATH, "r");
+    if (!f) return false;
+    LayoutCacheHeader hdr;
+    bool ok = f.read((uint8_t*)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+              hdr.magic == LAYOUT_CACHE_MAGIC && hdr.version == LAYOUT_CACHE_VERSION &&
+              f.size() == sizeof(hdr) + hdr.count * sizeof(LayoutCacheEntry) + hdr.strings_len;
+    if (!ok) { f.close(); return false; }
+
+    // Items first, then the raw file body; the item pointers go into the body's strings
+    size_t body_len = hdr.count * sizeof(LayoutCacheEntry) + hdr.strings_len;
+    size_t items_len = hdr.count * sizeof(LayoutItem);
+    uint8_t* mem = (uint8_t*)hd_malloc(HT_LAYOUT_CACHE, items_len + body_len + 1);
+    if (mem == NULL) { f.close(); return false; }
+    uint8_t* body = mem + items_len;
+    ok = f.read(body, body_len) == body_len;
+    f.close();
+
+    const char* strings = (const char*)(body + hdr.count * sizeof(LayoutCacheEntry));
+    ok = ok && fnv1a_n((const char*)body, body_len) == hdr.checksum &&
+         (hdr.strings_len == 0 || strings[hdr.strings_len - 1] == '\0');
+    if (!ok) {
+        LOG_W("Layout cache: corrupt, ignoring");
+        hd_free(mem);
+        return false;
+    }
+
+    LayoutItem* items = (LayoutItem*)mem;
+    const LayoutCacheEntry* entries = (const LayoutCacheEntry*)body;
+    for (uint16_t i = 0; i < hdr.count; i++) {
+        const LayoutCacheEntry* e = &entries[i];
+        if (e->entity >= hdr.strings_len || e->name >= hdr.strings_len ||
+            e->icon >= hdr.strings_len || e->room >= hdr.strings_len) {
+            hd_free(mem);
+            return false;
+        }
+        items[i].entity = strings + e->entity;
+        items[i].name = strings + e->name;
+        items[i].icon = strings + e->icon;
+        items[i].room = strings + e->room;
+        items[i].on = e->on != 0;
+    }
+
+    *items_out = items;
+    *count_out = hdr.count;
+    *hash_out = hdr.config_hash;
+    return true;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef LAYOUT_INDEX_H
+#define LAYOUT_INDEX_H
+
+#include <Arduino.h>
+#include "string_intern.h"
+#include "entity_state.h"
+#include "entity_index.h"
+#include "room_index.h"
+#include "panel_log.h"
+
+// --- LAYOUT TO INDEX ---
+// The part of a config apply that does not touch widgets: room list, entity
+// index diff, sort, room membership and state store pruning. apply_layout() in
+// ui_logic.h calls it before building the grid, and the host soak test calls
+// it on its own.
+
+// One button, as parsed from the config or loaded from the cache
+struct LayoutItem {
+    const char* entity;
+    const char* name;
+    const char* icon;
+    const char* room;
+    bool on;               // "state" from the config, used until HA reports
+};
+
+struct LayoutIndexResult {
+    bool rooms_changed;    // Chips must be rebuilt
+    int unknown;           // New entities HA has not reported a state for yet
+};
+
+static bool layout_state_is_configured(const EntityState* s) {
+    return entity_index_find(s->id) != NULL;
+}
+
+// Diffs `items` against the entity index: removed entities are dropped, changed
+// ones are patched, new ones are added and the rest keep their state. Leaves the
+// index sorted in config order. The item strings only need to stay valid for the call.
+LayoutIndexResult layout_index_apply(const LayoutItem* items, uint16_t count) {
+    LayoutIndexResult res = { false, 0 };
+
+    if (count == 0) {
+        entity_index_clear();
+        entity_state_prune(layout_state_is_configured);
+        room_index_clear();
+        return res;
+    }
+
+    // --- ROOM LIST ---
+    uint32_t prev_rooms = room_index_signature();
+    room_index_clear();
+    room_index_add(intern_string("My Home"));
+    for (uint16_t i = 0; i < count; i++) room_index_add(intern_string(items[i].room));
+    res.rooms_changed = room_index_signature() != prev_rooms;
+
+    // --- PASS 1: MARK ENTITIES STILL IN THE CONFIG ---
+    for (uint16_t i = 0; i < entity_count; i++) entity_index[i].seen = false;
+    for (uint16_t i = 0; i < count; i++) {
+        EntityEntry* ent = entity_index_find(items[i].entity);
+        if (ent) ent->seen = true;
+    }
+    entity_index_sweep(NULL);
+
+    // --- PASS 2: PATCH OR CREATE, IN CONFIG ORDER ---
+    for (uint16_t i = 0; i < entity_count; i++) entity_index[i].seen = false;
+    uint16_t order = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        const LayoutItem* item = &items[i];
+        const char* name = intern_string(item->name);
+        const char* icon = intern_string(item->icon);
+        const char* room = intern_string(item->room);
+        if (!name || !icon || !room) { LOG_E("UI: Out of memory, %s not shown", item->entity); continue; }
+
+        uint16_t room_idx = room_index_find(room);
+
+        EntityEntry* ent = entity_index_find(item->entity);
+        if (ent && ent->seen) continue;   // Duplicate entities are only shown once
+
+        if (ent) {
+            ent->room = room_idx;   // The visible page is rebound by the caller
+        } else {
+            ent = entity_index_add(item->entity, NULL, room_idx);
+            if (!ent) { LOG_E("UI: Entity index full, %s not shown", item->entity); continue; }
+            if (!ent->state->known) {
+                // Seed from the config until HA reports the real state
+                entity_state_set(ent->id, item->on);
+                res.unknown++;
+            }
+        }
+        ent->name = name;
+        ent->icon = icon;
+        ent->order = order++;
+        ent->seen = true;
+    }
+
+    entity_index_sort();
+    room_index_rebuild_members();
+    entity_state_prune(layout_state_is_configured);   // Forget entities the config dropped
+    return res;
+}
+
+#endif
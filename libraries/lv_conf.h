@@ -17,9 +17,15 @@
 #ifndef LV_CONF_H
 #define LV_CONF_H
 
-#define LV_MEM_CUSTOM 1 // AJAY
-#define LV_MEM_SIZE (128U * 1024U) //AJAY
-#define LV_MEM_CUSTOM_INCLUDE <stdlib.h> //AJAY
+/* AJAY: LVGL gets its own TLSF pool (LV_STDLIB_BUILTIN below), separate from the
+ * heap used by WiFi, MQTT and JSON. 1: the pool is allocated in PSRAM and can be
+ * larger, 0: internal RAM, faster but competes with the draw buffer. */
+#define LV_MEM_POOL_IN_PSRAM 1
+#if LV_MEM_POOL_IN_PSRAM
+    #define LV_MEM_SIZE (256U * 1024U) //AJAY
+#else
+    #define LV_MEM_SIZE (128U * 1024U) //AJAY
+#endif
 
 /* If you need to include anything here, do it inside the `__ASSEMBLY__` guard */
 #if  0 && defined(__ASSEMBLY__)
@@ -82,8 +88,12 @@
     #define LV_MEM_ADR 0     /**< 0: unused*/
     /* Instead of an address give a memory allocator that will be called to get a memory pool for LVGL. E.g. my_malloc */
     #if LV_MEM_ADR == 0
-        #undef LV_MEM_POOL_INCLUDE
-        #undef LV_MEM_POOL_ALLOC
+        #define LV_MEM_POOL_INCLUDE <esp_heap_caps.h> //AJAY
+        #if LV_MEM_POOL_IN_PSRAM
+            #define LV_MEM_POOL_ALLOC(size) heap_caps_malloc((size), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT) //AJAY
+        #else
+            #define LV_MEM_POOL_ALLOC(size) heap_caps_malloc((size), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) //AJAY
+        #endif
     #endif
 #endif  /*LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN*/
 
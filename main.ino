@@ -18,10 +18,23 @@
 #include "ui.h"
 #include "ui_comp.h"
 #include "ui_logic.h" 
+#include "mqtt_router.h"
+#include "mqtt_link.h"
+#include "panel_codec.h"
+#include "telemetry.h"
+#include "diag.h"
+#include "latency_stats.h"
+#include "ui_builder.h"
+#include "obj_pool.h"
+#include "panel_arena.h"
+#include "heap_debug.h"
+#include "fixed_string.h"
+#include "panel_sched.h"
+#include "ui_bind.h"
+#include "sensor_sampler.h"
 
 /* ================= CONFIG ================= */
 
-#define GRID_COLS 3
 #define MAX_BUTTONS 9
 
 #define LCD_BL_PIN 4
@@ -31,6 +44,7 @@
 #define MAX_NOTIFICATIONS 15
 #define MAX_SAVED_NETWORKS 5
 #define WIFI_RECONNECT_INTERVAL 60000
+#define MQTT_BUFFER_SIZE 16384   // Large enough for a config with a few hundred entities
 
 /* ================= BACKLIGHT CONFIG ================= */
 
@@ -59,8 +73,10 @@ struct SystemLocation {
     bool has_saved_data;
 };
 
-String pending_json_config = "";
+char* pending_config = NULL;        // Raw JSON or MessagePack, owned by the loop once pending
+unsigned int pending_config_len = 0;
 bool config_update_pending = false;
+lv_timer_t* config_task = NULL;     // Signalled when a config arrives, see setup_sched()
 
 /* ================= GLOBALS ================= */
 
@@ -106,6 +122,12 @@ int weather_code = 0;
 int is_day = 1;
 bool initial_weather_fetched = false;
 bool trigger_weather_update = false;
+lv_timer_t* weather_task = NULL;
+
+void request_weather_update() {
+    trigger_weather_update = true;
+    sched_signal(weather_task);
+}
 
 SystemLocation sysLoc = { 0.0, 0.0, 0, "Initial", false, false };
 
@@ -190,9 +212,9 @@ int  mqtt_port = 1883;
 char mqtt_user[32] = ""; 
 char mqtt_pass[32] = "";
 bool mqtt_enabled = false; 
-int  mqtt_retry_count = 0; 
-uint32_t last_mqtt_retry = 0;
+bool mqtt_report_failure = false;   // Show a popup if the first attempt after saving settings fails
 char mqtt_topic_notify[64] = "ha/panel/notify";
+int  route_notify = -1;
 
 lv_obj_t *ta_mqtt_topic;
 lv_obj_t *cont_ha_inputs; 
@@ -211,9 +233,15 @@ uint32_t popup_start_time = 0;
 // Notification Data
 char notification_history[MAX_NOTIFICATIONS][64]; 
 bool notification_ui_dirty = false; 
+lv_timer_t* notification_task = NULL;
+
+void mark_notifications_dirty() {
+    notification_ui_dirty = true;
+    sched_signal(notification_task);
+}
 
-uint32_t lastMillis = 0;
 uint32_t last_touch_ms = 0;
+lv_timer_t* display_task = NULL;    // Made ready on a new touch so wake-up is immediate
 uint32_t last_power_update = 0;
 float last_acc_x = 0, last_acc_y = 0, last_acc_z = 0;
 
@@ -245,7 +273,7 @@ struct DynamicSwitch {
 DynamicSwitch my_switches[MAX_BUTTONS];
 HaSwitch switches[MAX_BUTTONS];
 
-String get_weather_description(int code) {
+const char* get_weather_description(int code) {
     switch(code) {
         case 0: return "Clear Sky";
         case 1: return "Mainly Clear";
@@ -302,7 +330,7 @@ void update_about_text();
 void save_device_name(const char* new_name);
 void back_event_cb(lv_event_t *e);
 void refresh_notification_list();
-void add_notification(String msg); 
+void add_notification(const char* msg); 
 void load_saved_networks();
 void save_current_network_to_list();
 void remove_saved_network(const char* ssid_to_remove);
@@ -373,6 +401,7 @@ void touch_read_cb(lv_indev_t *indev, lv_indev_data_t *data) {
             touch_for_wake_only = false;
         }
         was_pressed = true;
+        if (display_task) lv_timer_ready(display_task);
     }
 
     if (touch_for_wake_only) {
@@ -446,14 +475,14 @@ void clear_all_notifications() {
   }
 }
 
-void add_notification(String msg) {
+void add_notification(const char* msg) {
     for (int k = MAX_NOTIFICATIONS - 1; k > 0; k--) {
         strncpy(notification_history[k], notification_history[k - 1], 64);
     }
-    strncpy(notification_history[0], msg.c_str(), 63);
+    strncpy(notification_history[0], msg, 63);
     notification_history[0][63] = '\0'; 
 
-    notification_ui_dirty = true;
+    mark_notifications_dirty();
 
     if (lv_scr_act() != ui_SleepScreen) {
         last_touch_ms = millis();
@@ -480,6 +509,7 @@ void check_sensor_logic() {
         else {
              last_touch_ms = millis();
         }
+        if (display_task) lv_timer_ready(display_task);
     }
   }
 }
@@ -550,20 +580,31 @@ void remove_saved_network(const char* ssid_to_remove) {
     refresh_saved_wifi_list_ui();
 }
 
+static lv_obj_t* create_saved_wifi_row(lv_obj_t* parent) {
+    lv_obj_t *btn = lv_list_add_btn(parent, LV_SYMBOL_WIFI, "");
+    lv_obj_set_style_bg_color(btn, lv_color_white(), 0);
+    lv_obj_set_style_text_color(btn, lv_color_black(), 0);
+    lv_obj_set_style_border_side(btn, LV_BORDER_SIDE_BOTTOM, 0);
+    lv_obj_set_style_border_width(btn, 1, 0);
+    lv_obj_set_style_border_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 3), 0);
+    lv_obj_add_event_cb(btn, saved_wifi_click_cb, LV_EVENT_CLICKED, NULL);
+    return btn;
+}
+
+ObjPool saved_wifi_pool = OBJ_POOL_INIT("wifi_saved", create_saved_wifi_row);
+
 void refresh_saved_wifi_list_ui() {
     if(!saved_list_ui) return;
-    lv_obj_clean(saved_list_ui);
+    uint32_t rows = 0;
     for(int i=0; i<MAX_SAVED_NETWORKS; i++) {
         if(saved_networks[i].valid) {
-            lv_obj_t *btn = lv_list_add_btn(saved_list_ui, LV_SYMBOL_WIFI, saved_networks[i].ssid);
-            lv_obj_set_style_bg_color(btn, lv_color_white(), 0);
-            lv_obj_set_style_text_color(btn, lv_color_black(), 0);
-            lv_obj_set_style_border_side(btn, LV_BORDER_SIDE_BOTTOM, 0);
-            lv_obj_set_style_border_width(btn, 1, 0);
-            lv_obj_set_style_border_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 3), 0);
-            lv_obj_add_event_cb(btn, saved_wifi_click_cb, LV_EVENT_CLICKED, NULL);
+            lv_obj_t *btn = obj_pool_row(&saved_wifi_pool, saved_list_ui, rows);
+            if (!btn) break;
+            ui_bind_text(lv_obj_get_child(btn, -1), saved_networks[i].ssid);
+            rows++;
         }
     }
+    obj_pool_hide_rows(saved_list_ui, rows);
 }
 
 void wipe_wifi_popup() {
@@ -587,7 +628,7 @@ void wipe_wifi_popup() {
 }
 
 void reset_grid_to_defaults() {
-    Serial.println("--- RESETTING GRID CONFIGURATION ---");
+    LOG_I("--- RESETTING GRID CONFIGURATION ---");
 
     prefs.begin("grid_cfg", false);
     prefs.clear(); 
@@ -610,6 +651,7 @@ void load_settings() {
   String s = prefs.getString("dev_name", "ESP32-S3-Panel");
   s.toCharArray(deviceName, 32);
   WiFi.setHostname(deviceName);
+  mqtt_set_device_id(deviceName);
 
   String ss = prefs.getString("wifi_ssid", "");
   ss.toCharArray(wifi_ssid, 32);
@@ -643,6 +685,10 @@ void save_device_name(const char* new_name) {
   prefs.end();
   snprintf(deviceName, 32, "%s", new_name);
   WiFi.setHostname(deviceName);
+  mqtt_set_device_id(deviceName);
+  latency_topics_changed();
+  telemetry_topics_changed();
+  diag_topics_changed();
 }
 
 // --- LOADER HELPERS ---
@@ -674,7 +720,7 @@ void hide_loader() {
         lv_obj_del(loader_overlay);
         loader_overlay = NULL;
         loader_label = NULL;
-        lv_timer_handler();
+        lv_refr_now(NULL);
     }
 }
 
@@ -688,54 +734,26 @@ void save_ha_settings(const char* h, const char* p_str, const char* u, const cha
   prefs.putBool("mqtt_en", en);
   prefs.end();
 
+  // Safe while a connect attempt runs: the link task uses its own copy
   snprintf(mqtt_host, 64, "%s", h);
   mqtt_port = atoi(p_str);
   snprintf(mqtt_user, 32, "%s", u);
   snprintf(mqtt_pass, 32, "%s", p);
   snprintf(mqtt_topic_notify, 64, "%s", topic);
+  mqtt_link_set_route_filter(route_notify, mqtt_topic_notify);
   
   if (en) {
-      show_loader("Connecting MQTT...");        
-
-      mqtt.setServer(mqtt_host, mqtt_port);
-      wifiClient.setTimeout(2000); 
-
-      bool connected = false;
-      if (strlen(mqtt_user) > 0) connected = mqtt.connect("esp32_panel", mqtt_user, mqtt_pass);
-      else connected = mqtt.connect("esp32_panel");
-
-      hide_loader();
-
-      if (connected) {
-          Serial.println("MQTT Connected Immediately!");
-          mqtt_enabled = true;
-          mqtt_retry_count = 0;
-          
-          if(lbl_ha_status) {
-              lv_label_set_text(lbl_ha_status, "Status: Connected");
-              lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_GREEN), 0);
-          }
-
-          // Subscribe to the Config Topic!
-          mqtt.subscribe("ha/panel/config/set");
-          mqtt.subscribe("ha/panel/state/update");
-          mqtt.subscribe(mqtt_topic_notify);
-          mqtt.publish("ha/panel/sync", "get_states");
-      } else {
-          mqtt_enabled = false; 
-          if(sw_mqtt_enable) lv_obj_clear_state(sw_mqtt_enable, LV_STATE_CHECKED);
-          if(lbl_ha_status) {
-              lv_label_set_text(lbl_ha_status, "Status: Connection Failed");
-              lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_RED), 0);
-          }
-          prefs.begin("sys_config", false);
-          prefs.putBool("mqtt_en", false);
-          prefs.end();
-          show_notification_popup("Error: Connection Failed.\nCheck Host IP/User or WiFi.", -1);
+      // Reconnect with the new settings in the background (handle_mqtt_loop)
+      mqtt_enabled = true;
+      mqtt_report_failure = true;
+      mqtt_link_reset();
+      if(lbl_ha_status) {
+          lv_label_set_text(lbl_ha_status, "Status: Connecting...");
+          lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_ORANGE), 0);
       }
   } else {
       mqtt_enabled = false;
-      mqtt.disconnect();
+      mqtt_link_stop();
       if(lbl_ha_status) {
           lv_label_set_text(lbl_ha_status, "Status: Disabled");
           lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_GREY), 0);
@@ -752,11 +770,11 @@ void popup_event_cb(lv_event_t *e) {
   if(code == LV_EVENT_CLICKED) {
     if(action_id == 1) { 
       delete_notification(selected_notification_index);
-      notification_ui_dirty = true;
+      mark_notifications_dirty();
     } 
     else if (action_id == 3) { 
       clear_all_notifications();
-      notification_ui_dirty = true;
+      mark_notifications_dirty();
     }
     
     if(msg_popup) {
@@ -880,7 +898,7 @@ void list_item_clicked_cb(lv_event_t *e) {
   if (lv_indev_get_scroll_obj(indev) != NULL || lv_indev_get_gesture_dir(indev) != LV_DIR_NONE) {
       return;
   }
-  intptr_t idx = (intptr_t)lv_event_get_user_data(e);
+  intptr_t idx = (intptr_t)lv_obj_get_user_data((lv_obj_t *)lv_event_get_target(e));
   if(idx >= 0 && idx < MAX_NOTIFICATIONS) {
     show_notification_popup(notification_history[idx], (int)idx);
   }
@@ -890,9 +908,26 @@ void clear_all_event_cb(lv_event_t *e) {
   show_clear_all_popup();
 }
 
+// Rows are pooled and refreshed in place; the notification index lives in the row's user data.
+static lv_obj_t* create_notification_row(lv_obj_t* parent) {
+    lv_obj_t *btn = lv_list_add_btn(parent, LV_SYMBOL_BELL, "");
+    lv_obj_set_style_bg_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 4), 0); 
+    lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, 0);
+    lv_obj_set_style_text_color(btn, lv_color_black(), 0);
+    lv_obj_set_style_text_font(btn, &lv_font_montserrat_16, 0);
+    lv_obj_set_style_radius(btn, 10, 0);
+    lv_obj_set_style_border_width(btn, 1, 0);
+    lv_obj_set_style_border_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 2), 0);
+    lv_obj_set_style_border_side(btn, (lv_border_side_t)(LV_BORDER_SIDE_LEFT | LV_BORDER_SIDE_BOTTOM | LV_BORDER_SIDE_TOP | LV_BORDER_SIDE_RIGHT), 0);
+    lv_obj_add_flag(btn, LV_OBJ_FLAG_CLICKABLE); 
+    lv_obj_add_event_cb(btn, list_item_clicked_cb, LV_EVENT_CLICKED, NULL);
+    return btn;
+}
+
+ObjPool notification_pool = OBJ_POOL_INIT("notify", create_notification_row);
+
 void refresh_notification_list() {
     if (!notification_list) return;
-    lv_obj_clean(notification_list); 
     
     int count = get_notification_count();
     
@@ -900,6 +935,7 @@ void refresh_notification_list() {
         lv_obj_add_flag(notification_list, LV_OBJ_FLAG_HIDDEN);
         lv_obj_clear_flag(no_notification_label, LV_OBJ_FLAG_HIDDEN);
         lv_obj_add_flag(btn_clear_all, LV_OBJ_FLAG_HIDDEN); 
+        obj_pool_hide_rows(notification_list, 0);
     } else {
         lv_obj_clear_flag(notification_list, LV_OBJ_FLAG_HIDDEN);
         lv_obj_add_flag(no_notification_label, LV_OBJ_FLAG_HIDDEN);
@@ -909,77 +945,99 @@ void refresh_notification_list() {
             lv_obj_add_flag(btn_clear_all, LV_OBJ_FLAG_HIDDEN);
         }
 
+        uint32_t rows = 0;
         for(int i = 0; i < MAX_NOTIFICATIONS; i++) {
             if (notification_history[i][0] != '\0') {
-                lv_obj_t *btn = lv_list_add_btn(notification_list, LV_SYMBOL_BELL, notification_history[i]);
-                lv_obj_set_style_bg_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 4), 0); 
-                lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, 0);
-                lv_obj_set_style_text_color(btn, lv_color_black(), 0);
-                lv_obj_set_style_text_font(btn, &lv_font_montserrat_16, 0);
-                lv_obj_set_style_radius(btn, 10, 0);
-                lv_obj_set_style_border_width(btn, 1, 0);
-                lv_obj_set_style_border_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 2), 0);
-                lv_obj_set_style_border_side(btn, (lv_border_side_t)(LV_BORDER_SIDE_LEFT | LV_BORDER_SIDE_BOTTOM | LV_BORDER_SIDE_TOP | LV_BORDER_SIDE_RIGHT), 0);
-                lv_obj_add_flag(btn, LV_OBJ_FLAG_CLICKABLE); 
-                lv_obj_add_event_cb(btn, list_item_clicked_cb, LV_EVENT_CLICKED, (void*)(intptr_t)i);
+                lv_obj_t *btn = obj_pool_row(&notification_pool, notification_list, rows);
+                if (!btn) break;
+                ui_bind_text(lv_obj_get_child(btn, -1), notification_history[i]);
+                lv_obj_set_user_data(btn, (void*)(intptr_t)i);
+                rows++;
             }
         }
+        obj_pool_hide_rows(notification_list, rows);
     }
 }
 
 /* ================= MQTT CALLBACKS ================= */
 
-void mqtt_callback(char* topic, byte* payload, unsigned int len) {
-    Serial.print("Message arrived [");
-    Serial.print(topic);
-    Serial.println("]");
-
-    char* p_buff = (char*)malloc(len + 1);
-    if (p_buff == NULL) {
-        Serial.println("Error: Not enough memory for MQTT payload");
+// 1. HANDLE CONFIGURATION UPDATE
+void on_config_set_msg(const char* topic, const char* wildcard, char* payload, unsigned int len) {
+    LOG_I("Config received (%u bytes). Scheduling update...", len);
+    // DECOUPLED: Save payload and set flag. Do NOT call refresh_ui_data here.
+    // Copied with its length: MessagePack configs may contain NUL bytes.
+    char* copy = (char*)panel_arena_alloc(&net_arena, len + 1);
+    if (copy == NULL) { LOG_E("Error: Not enough memory for config"); return; }
+    memcpy(copy, payload, len + 1);
+    panel_arena_free(&net_arena, pending_config);
+    pending_config = copy;
+    pending_config_len = len;
+    config_update_pending = true;
+    sched_signal(config_task);
+}
+
+// 2. HANDLE STATE UPDATES FROM HA
+// Accepts a single {"entity_id","state"} envelope, {"states": [...]} or a bare array
+// of envelopes, as JSON or MessagePack. Batches are applied in one pass with a single redraw.
+// `entity_id` is used for an envelope without one (per-entity topics).
+static void apply_state_doc(const char* payload, unsigned int len, const char* entity_id) {
+    JsonDocument doc(&json_allocator);
+    DeserializationError error = panel_deserialize(doc, payload, len);
+    if (error) return;
+
+    if (doc.is<JsonArray>()) {
+        update_device_states(doc.as<JsonArrayConst>());
+        return;
+    }
+    JsonArrayConst batch = doc["states"];
+    if (!batch.isNull()) {
+        update_device_states(batch);
         return;
     }
-    memcpy(p_buff, payload, len);
-    p_buff[len] = '\0';
 
-    // 1. HANDLE CONFIGURATION UPDATE
-    // if (strcmp(topic, "ha/panel/config/set") == 0) {
-    //     show_loader("Updating Layout...");
-    //     // Replaced custom parsing with ui_logic.h handler
-    //     refresh_ui_data(p_buff); 
-    //     Serial.println("UI Config Updated via ui_logic");
-    //     hide_loader();
-    // }
+    update_device_state_json(doc.as<JsonObjectConst>(), entity_id);
+}
 
-    if (strcmp(topic, "ha/panel/config/set") == 0) {
-        Serial.println("Config received. Scheduling update...");
-        // DECOUPLED: Save string and set flag. Do NOT call refresh_ui_data here.
-        pending_json_config = String(p_buff); 
-        config_update_pending = true;         
-    }
+// Batch topic: ha/panel/states. It sits outside ha/panel/state/ so that the
+// broker never delivers one message to both subscriptions.
+void on_state_update_msg(const char* topic, const char* wildcard, char* payload, unsigned int len) {
+    apply_state_doc(payload, len, NULL);
+}
 
-    // 2. HANDLE STATE UPDATES FROM HA
-    if (strcmp(topic, "ha/panel/state/update") == 0) {
-        JsonDocument doc;
-        DeserializationError error = deserializeJson(doc, p_buff);
-        
-        if (!error) {
-            const char* id = doc["entity_id"];
-            const char* st = doc["state"];
-            bool isOn = (strcasecmp(st, "on") == 0) || (strcasecmp(st, "open") == 0);
-            
-            // Call new logic helper instead of manual loop
-            update_device_state(id, isOn); 
-        }
-    }
+// 2b. PER-ENTITY STATE TOPIC: ha/panel/state/<entity_id>
+// Plain "on"/"off"/"open"/"closed" payloads skip JSON entirely. Documents take
+// any form the batch topic does, so automations still publishing batches to the
+// old ha/panel/state/update topic keep working; a bare payload there is the
+// state of an entity called "update", like on any other per-entity topic.
+void on_entity_state_msg(const char* topic, const char* wildcard, char* payload, unsigned int len) {
+    if (wildcard == NULL || wildcard[0] == '\0') return;
 
-    // 3. HANDLE NOTIFICATIONS
-    if (strcmp(topic, mqtt_topic_notify) == 0) {
-        String msg = String(p_buff);
-        if (msg.length() > 0) add_notification(msg);
+    if (panel_payload_is_document(payload, len)) {
+        apply_state_doc(payload, len, wildcard);
+    } else {
+        update_device_state(wildcard, state_payload_is_on(payload));
     }
+}
+
+// 3. HANDLE NOTIFICATIONS
+void on_notify_msg(const char* topic, const char* wildcard, char* payload, unsigned int len) {
+    if (len > 0) add_notification(payload);
+}
 
-    free(p_buff);
+void setup_mqtt_routes() {
+    mqtt_router_on("ha/panel/config/set", on_config_set_msg);
+    mqtt_router_on("ha/panel/states", on_state_update_msg);
+    mqtt_router_on("ha/panel/state/+", on_entity_state_msg);
+    route_notify = mqtt_router_on(mqtt_topic_notify, on_notify_msg);
+    latency_setup_routes();
+    telemetry_setup_routes();
+    diag_setup_routes();
+}
+
+void mqtt_callback(char* topic, byte* payload, unsigned int len) {
+    LOG_D("MQTT: message on %s (%u bytes)", topic, len);
+
+    mqtt_router_dispatch(topic, payload, len);
 }
 
 /* ================= UI CALLBACKS ================= */
@@ -1048,7 +1106,7 @@ void swipe_event_cb(lv_event_t *e) {
 
 void back_event_cb(lv_event_t *e) {
     if (lv_scr_act() == screen_wifi && wifi_enabled && WiFi.status() != WL_CONNECTED) {
-        Serial.println("User left WiFi screen without connecting. Disabling.");
+        LOG_I("User left WiFi screen without connecting. Disabling.");
         wifi_enabled = false;
         current_wifi_state = WIFI_IDLE;
         
@@ -1096,6 +1154,42 @@ void wifi_list_btn_cb(lv_event_t * e) {
     lv_obj_clear_flag(kb_wifi, LV_OBJ_FLAG_HIDDEN);
 }
 
+// The close button and message line are created once and stay at the top of
+// the scan list; network rows below them come from scan_row_pool.
+lv_obj_t *scan_close_btn = NULL;
+lv_obj_t *scan_msg_label = NULL;
+
+static lv_obj_t* create_scan_row(lv_obj_t* parent) {
+    lv_obj_t *btn = lv_list_add_btn(parent, LV_SYMBOL_WIFI, "");
+    lv_obj_set_style_text_color(btn, lv_color_black(), 0);
+    lv_obj_set_style_bg_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 3), 0);
+    lv_obj_set_style_border_side(btn, LV_BORDER_SIDE_BOTTOM, 0);
+    lv_obj_set_style_border_width(btn, 1, 0);
+    lv_obj_set_style_border_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 4), 0);
+    lv_obj_add_event_cb(btn, wifi_list_btn_cb, LV_EVENT_CLICKED, NULL);
+    return btn;
+}
+
+ObjPool scan_row_pool = OBJ_POOL_INIT("wifi_scan", create_scan_row);
+
+void scan_list_reset(const char* msg, lv_color_t text_color, bool show_close) {
+    if (!scan_list_ui) return;
+    if (!scan_close_btn) {
+        scan_close_btn = lv_list_add_btn(scan_list_ui, LV_SYMBOL_CLOSE, " Close");
+        lv_obj_set_style_bg_color(scan_close_btn, lv_palette_lighten(LV_PALETTE_GREY, 3), 0); 
+        lv_obj_set_style_text_color(scan_close_btn, lv_color_black(), 0);
+        lv_obj_add_event_cb(scan_close_btn, [](lv_event_t* e){ wipe_wifi_popup(); }, LV_EVENT_CLICKED, NULL);
+
+        scan_msg_label = lv_list_add_text(scan_list_ui, "");
+        lv_obj_set_style_bg_color(scan_msg_label, lv_palette_lighten(LV_PALETTE_GREY, 3), 0); 
+    }
+    obj_pool_hide_rows(scan_list_ui, 0, 2);
+
+    ui_bind_text(scan_msg_label, msg);
+    ui_bind_text_color(scan_msg_label, text_color);
+    ui_bind_hidden(scan_close_btn, !show_close);
+}
+
 void btn_scan_wifi_cb(lv_event_t * e) {
     if (current_wifi_state == WIFI_SCANNING || current_wifi_state == WIFI_CONNECTING) return;
     
@@ -1107,11 +1201,8 @@ void btn_scan_wifi_cb(lv_event_t * e) {
     if(saved_list_ui) lv_obj_add_flag(saved_list_ui, LV_OBJ_FLAG_HIDDEN); 
     
     if(scan_list_ui) {
-        lv_obj_clean(scan_list_ui);
+        scan_list_reset("Scanning... Please wait", lv_color_black(), false);
         lv_obj_clear_flag(scan_list_ui, LV_OBJ_FLAG_HIDDEN); 
-        lv_obj_t * txt = lv_list_add_text(scan_list_ui, "Scanning... Please wait");
-        lv_obj_set_style_bg_color(txt, lv_palette_lighten(LV_PALETTE_GREY, 3), 0); 
-        lv_obj_set_style_text_color(txt, lv_color_black(), 0);
     }
     
     current_wifi_state = WIFI_SCANNING;
@@ -1152,8 +1243,7 @@ void btn_save_wifi_cb(lv_event_t * e) {
         lv_label_set_text(lbl_wifi_status, "Status: Connecting...");
         lv_obj_set_style_text_color(lbl_wifi_status, lv_palette_main(LV_PALETTE_ORANGE), 0);
         
-        mqtt.disconnect(); 
-        mqtt_retry_count = 0; 
+        mqtt_link_stop();
 
         WiFi.disconnect();
         WiFi.begin(wifi_ssid, wifi_pass);
@@ -1219,8 +1309,7 @@ void sw_wifi_event_cb(lv_event_t * e) {
 
         if (mqtt_enabled) {
             mqtt_enabled = false;
-            mqtt_retry_count = 0; 
-            mqtt.disconnect(); 
+            mqtt_link_stop();
 
             prefs.begin("sys_config", false);
             prefs.putBool("mqtt_en", false);
@@ -1275,14 +1364,14 @@ void sw_ha_event_cb(lv_event_t * e) {
 
     if(is_on) {
         lv_obj_clear_flag(cont_ha_inputs, LV_OBJ_FLAG_HIDDEN);
-        mqtt_retry_count = 0; 
+        mqtt_link_reset();
         if(lbl_ha_status) {
              lv_label_set_text(lbl_ha_status, "Status: Ready to Connect");
              lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_GREY), 0);
         }
     } else {
         lv_obj_add_flag(cont_ha_inputs, LV_OBJ_FLAG_HIDDEN);
-        mqtt.disconnect();
+        mqtt_link_stop();
         if(lbl_ha_status) {
             lv_label_set_text(lbl_ha_status, "Status: Disabled");
             lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_GREY), 0);
@@ -1351,6 +1440,7 @@ void settings_menu_event_cb(lv_event_t *e) {
     if(lv_indev_get_gesture_dir(indev) != LV_DIR_NONE) return;
     intptr_t user_data = (intptr_t)lv_event_get_user_data(e);
     if(code == LV_EVENT_CLICKED) {
+        ui_builder_finish(); // Target screen may still be queued
         if(user_data == 1) lv_scr_load_anim(screen_about, LV_SCR_LOAD_ANIM_MOVE_LEFT, 200, 0, false);
         else if (user_data == 2) lv_scr_load_anim(screen_power, LV_SCR_LOAD_ANIM_MOVE_LEFT, 200, 0, false);
         else if (user_data == 3) lv_scr_load_anim(screen_wifi, LV_SCR_LOAD_ANIM_MOVE_LEFT, 200, 0, false);
@@ -1399,7 +1489,7 @@ void load_display_prefs() {
     prefs.end();
     
     set_brightness(setting_brightness);
-    Serial.printf("Disp: B=%d%%, Saver=%u, Sleep=%u\n", setting_brightness, setting_saver_ms, setting_sleep_ms);
+    LOG_I("Disp: B=%d%%, Saver=%u, Sleep=%u", setting_brightness, setting_saver_ms, setting_sleep_ms);
 }
 
 void save_display_prefs() {
@@ -1408,7 +1498,7 @@ void save_display_prefs() {
     prefs.putUInt("saver", setting_saver_ms);
     prefs.putUInt("sleep", setting_sleep_ms);
     prefs.end();
-    Serial.println("Display Preferences Saved.");
+    LOG_I("Display Preferences Saved.");
 }
 
 // Helper to find index for dropdown based on ms value
@@ -2093,7 +2183,7 @@ void save_time_date_cb(lv_event_t * e) {
     if (time_is_pm && h < 12) h += 12;
     else if (!time_is_pm && h == 12) h = 0;
 
-    Serial.printf("Saving RTC: %04d-%02d-%02d %02d:%02d\n", y, mo, d, h, m);
+    LOG_I("Saving RTC: %04d-%02d-%02d %02d:%02d", y, mo, d, h, m);
     rtc.setDateTime(y, mo, d, h, m, 0);
     back_event_cb(NULL);
 }
@@ -2145,7 +2235,7 @@ void sw_ntp_event_cb(lv_event_t * e) {
         lv_obj_add_flag(cont_manual_time, LV_OBJ_FLAG_HIDDEN);
         if(WiFi.status() == WL_CONNECTED) {
             configTime(sysLoc.utc_offset, 0, "pool.ntp.org", "time.nist.gov");
-            trigger_weather_update = true; 
+            request_weather_update();
         }
     } else {
         lv_obj_clear_flag(cont_manual_time, LV_OBJ_FLAG_HIDDEN);
@@ -2207,7 +2297,7 @@ void btn_save_loc_cb(lv_event_t * e) {
     }
     
     save_location_prefs();
-    trigger_weather_update = true; 
+    request_weather_update();
     
     lv_scr_load_anim(screen_settings_menu, LV_SCR_LOAD_ANIM_MOVE_RIGHT, 200, 0, false);
 }
@@ -2227,7 +2317,7 @@ void sw_auto_loc_cb(lv_event_t * e) {
         lv_obj_add_flag(cont_manual_loc, LV_OBJ_FLAG_HIDDEN);
         sysLoc.is_manual = false;
         save_location_prefs(); 
-        trigger_weather_update = true;
+        request_weather_update();
         if(lbl_loc_current) lv_label_set_text(lbl_loc_current, "Fetching IP Location...");
     } else {
         lv_obj_clear_flag(cont_manual_loc, LV_OBJ_FLAG_HIDDEN);
@@ -2254,7 +2344,7 @@ void perform_geocoding_search(const char* query) {
     
     String url = "http://geocoding-api.open-meteo.com/v1/search?name=" + q + "&count=1&language=en&format=json";
     
-    Serial.println("Geocoding: " + url);
+    LOG_D("Geocoding: %s", url.c_str());
     http.begin(client, url);
     
     int code = http.GET();
@@ -2308,7 +2398,7 @@ void load_location_prefs() {
 
     configTime(sysLoc.utc_offset, 0, "pool.ntp.org");
     
-    Serial.printf("Loaded Loc: %s (Manual: %s)\n", sysLoc.city, sysLoc.is_manual ? "YES" : "NO");
+    LOG_I("Loaded Loc: %s (Manual: %s)", sysLoc.city, sysLoc.is_manual ? "YES" : "NO");
 }
 
 void save_location_prefs() {
@@ -2322,7 +2412,7 @@ void save_location_prefs() {
     prefs.putBool("has_data", true);
 
     prefs.end();
-    Serial.println("Location Preferences Saved.");
+    LOG_I("Location Preferences Saved.");
 }
 
 void create_location_screen(lv_obj_t *parent) {
@@ -2568,7 +2658,7 @@ void create_time_date_screen(lv_obj_t *parent) {
 
 void fetch_weather_data() {
     if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("Skipping fetch: No WiFi");
+        LOG_W("Skipping fetch: No WiFi");
         return;
     }
     show_loader("Resolving Location...");
@@ -2582,7 +2672,7 @@ void fetch_weather_data() {
     // 1. IP Geolocation (HTTP)
     // ---------------------------------------------
     if (!sysLoc.is_manual) {
-        Serial.println("Finding IP Geolocation...");
+        LOG_I("Finding IP Geolocation...");
         update_loader_msg("Finding IP Location...");
         
         WiFiClient client;  // Local instance
@@ -2609,15 +2699,15 @@ void fetch_weather_data() {
                     }
                     city_name = String(sysLoc.city);
                     if (ui_LabelCity) lv_label_set_text(ui_LabelCity, sysLoc.city);
-                    Serial.printf("IP Loc Found: %s (%.4f, %.4f)\n", sysLoc.city, geo_lat, geo_lon);
+                    LOG_I("IP Loc Found: %s (%.4f, %.4f)", sysLoc.city, geo_lat, geo_lon);
                 }
             } else {
-                Serial.printf("IP-API Error: %d. Using saved coords.\n", httpCode);
+                LOG_W("IP-API Error: %d. Using saved coords.", httpCode);
             }
             http.end(); // Important: Close connection
         }
     } else {
-        Serial.println("Using Manual Location...");
+        LOG_I("Using Manual Location...");
         if (ui_LabelCity) lv_label_set_text(ui_LabelCity, sysLoc.city);
     }
 
@@ -2625,7 +2715,7 @@ void fetch_weather_data() {
     // 2. Time Sync (HTTPS)
     // ---------------------------------------------
     if (ntp_auto_update && geo_lat != 0.0) {
-        Serial.println("Finding Time...");
+        LOG_I("Finding Time...");
         update_loader_msg("Syncing Time...");
         
         WiFiClientSecure clientS; // Local Secure Client
@@ -2658,11 +2748,11 @@ void fetch_weather_data() {
                             dt.substring(17, 19).toInt()  // Sec
                         );
                     }
-                    Serial.printf("Time Synced! Offset: %d\n", sysLoc.utc_offset);
+                    LOG_I("Time Synced! Offset: %d", sysLoc.utc_offset);
                     if (lv_scr_act() == screen_time_date) time_screen_load_cb(NULL);
                 }
             } else {
-                Serial.printf("TimeAPI Error: %d\n", tCode);
+                LOG_W("TimeAPI Error: %d", tCode);
             }
             httpS.end(); // Close connection
         }
@@ -2674,7 +2764,7 @@ void fetch_weather_data() {
     // 3. Weather (HTTP)
     // ---------------------------------------------
     if (geo_lat != 0.0) {
-        Serial.printf("Fetching Weather for: %.4f, %.4f\n", geo_lat, geo_lon);
+        LOG_I("Fetching Weather for: %.4f, %.4f", geo_lat, geo_lon);
         update_loader_msg("Updating Weather...");
         
         WiFiClient client; // Local instance
@@ -2699,22 +2789,24 @@ void fetch_weather_data() {
                 weather_code = docWeather["current_weather"]["weathercode"];
                 is_day = docWeather["current_weather"]["is_day"];
                 
-                Serial.printf("API Data -> Temp: %.1f, Code: %d, Is_Day: %d\n", current_temp, weather_code, is_day);
+                LOG_I("API Data -> Temp: %.1f, Code: %d, Is_Day: %d", current_temp, weather_code, is_day);
 
                 initial_weather_fetched = true;
 
-                if(ui_LabelTemp) lv_label_set_text(ui_LabelTemp, (String(current_temp, 0) + "°").c_str());
-                if(ui_LabelWeather) lv_label_set_text(ui_LabelWeather, get_weather_description(weather_code).c_str());
+                FixedString<16> t;
+                t.appendf("%.0f°", current_temp);
+                if(ui_LabelTemp) lv_label_set_text(ui_LabelTemp, t.c_str());
+                if(ui_LabelWeather) lv_label_set_text(ui_LabelWeather, get_weather_description(weather_code));
                 
                 update_weather_ui(get_weather_type(weather_code), (is_day == 0));
             } else {
-                Serial.printf("Weather Error: %d\n", wCode);
+                LOG_W("Weather Error: %d", wCode);
             }
             http.end();
         }
     }
     
-    Serial.println("--- Fetch Complete ---");
+    LOG_I("--- Fetch Complete ---");
     hide_loader();
 }
 
@@ -2828,13 +2920,13 @@ void show_loader(const char* msg) {
     lv_obj_set_style_text_font(loader_label, &lv_font_montserrat_20, 0);
     lv_obj_align(loader_label, LV_ALIGN_CENTER, 0, 70);
 
-    lv_timer_handler(); 
+    lv_refr_now(NULL);
 }
 
 void update_loader_msg(const char* msg) {
     if (loader_label) {
         lv_label_set_text(loader_label, msg);
-        lv_timer_handler();
+        lv_refr_now(NULL);
     }
 }
 
@@ -2844,10 +2936,12 @@ void update_loader_msg(const char* msg) {
 void save_grid_config() {
     prefs.begin("grid_cfg", false);
     for (int i = 0; i < MAX_BUTTONS; i++) {
-        String key = "btn_" + String(i);
+        FixedString<12> key;
+        key.appendf("btn_%d", i);
         // Save as pipe-separated string: "Kitchen|light.kitchen|ð"
-        String val = String(my_switches[i].name) + "|" + String(my_switches[i].entity_id) + "|" + String(my_switches[i].icon);
-        prefs.putString(key.c_str(), val);
+        FixedString<96> val;
+        val.append(my_switches[i].name).append('|').append(my_switches[i].entity_id).append('|').append(my_switches[i].icon);
+        prefs.putString(key.c_str(), val.c_str());
     }
     prefs.end();
 }
@@ -2856,19 +2950,20 @@ void save_grid_config() {
 void load_grid_config() {
     prefs.begin("grid_cfg", true);
     for (int i = 0; i < MAX_BUTTONS; i++) {
-        String val = prefs.getString(("btn_" + String(i)).c_str(), "Unset|none|" LV_SYMBOL_PLUS);
-        
-        // Simple parser
-        int firstPipe = val.indexOf('|');
-        int lastPipe = val.lastIndexOf('|');
+        FixedString<12> key;
+        key.appendf("btn_%d", i);
+        char val[96];
+        if (prefs.getString(key.c_str(), val, sizeof(val)) == 0) snprintf(val, sizeof(val), "Unset|none|" LV_SYMBOL_PLUS);
         
-        String n = val.substring(0, firstPipe);
-        String e = val.substring(firstPipe + 1, lastPipe);
-        String ic = val.substring(lastPipe + 1);
+        // Simple parser: "name|entity|icon"
+        const char* firstPipe = strchr(val, '|');
+        const char* lastPipe = strrchr(val, '|');
+        if (firstPipe == NULL) firstPipe = lastPipe = val + strlen(val);
         
-        strncpy(my_switches[i].name, n.c_str(), 15);
-        strncpy(my_switches[i].entity_id, e.c_str(), 63);
-        strncpy(my_switches[i].icon, ic.c_str(), 7);
+        snprintf(my_switches[i].name, sizeof(my_switches[i].name), "%.*s", (int)(firstPipe - val), val);
+        snprintf(my_switches[i].entity_id, sizeof(my_switches[i].entity_id), "%.*s",
+                 lastPipe > firstPipe ? (int)(lastPipe - firstPipe - 1) : 0, firstPipe + 1);
+        snprintf(my_switches[i].icon, sizeof(my_switches[i].icon), "%s", *lastPipe ? lastPipe + 1 : "");
         my_switches[i].state = false;
     }
     prefs.end();
@@ -2879,6 +2974,8 @@ void load_grid_config() {
 
 void setup() {
     Serial.begin(115200);
+    panel_log_init();
+    panel_arenas_init();
     Wire.begin(47, 48);
     Wire.setTimeOut(100);
 
@@ -2922,22 +3019,49 @@ void setup() {
 
     load_settings(); 
 
+    telemetry_init(disp);
+    // The only place the PMU is polled, see sensor_sampler.h
+    sampler_pmu_cb = [](PanelPowerSample* b) {
+        b->present = power.isBatteryConnect();
+        b->vbus_mv = power.getVbusVoltage();
+        b->usb = b->vbus_mv > 4000;
+        b->charging = b->present && power.isCharging();
+        b->percent = b->present ? power.getBatteryPercent() : -1;
+        b->mv = b->present ? power.getBattVoltage() : 0;
+        return true;
+    };
+
     // --- INIT UI ---
 
     
     ui_init(); 
     setup_ui_logic(); 
+    load_cached_layout();   // Last known grid, usable before WiFi/MQTT come up
 
     // Create Manual Screens
+    // Screens reachable by swipe, and WiFi (its state is applied below), are built now.
+    // The other settings screens are filled in by the UI builder over the first frames;
+    // settings_menu_event_cb() finishes the build before any of them is loaded.
     screen_notifications = lv_obj_create(NULL); create_notifications_page(screen_notifications);
     screen_settings_menu = lv_obj_create(NULL); create_settings_menu_screen(screen_settings_menu);
-    screen_power = lv_obj_create(NULL); create_power_screen(screen_power);
     screen_wifi = lv_obj_create(NULL); create_wifi_screen(screen_wifi);
-    screen_ha = lv_obj_create(NULL); create_ha_screen(screen_ha);
-    screen_about = lv_obj_create(NULL); create_about_screen(screen_about);
-    screen_time_date = lv_obj_create(NULL); create_time_date_screen(screen_time_date);
-    screen_location = lv_obj_create(NULL); create_location_screen(screen_location);
-    screen_display = lv_obj_create(NULL); create_display_screen(screen_display);
+    screen_power = lv_obj_create(NULL);     ui_builder_push([](void*) { create_power_screen(screen_power); });
+    screen_ha = lv_obj_create(NULL);        ui_builder_push([](void*) { create_ha_screen(screen_ha); });
+    screen_about = lv_obj_create(NULL);     ui_builder_push([](void*) { create_about_screen(screen_about); });
+    screen_time_date = lv_obj_create(NULL); ui_builder_push([](void*) { create_time_date_screen(screen_time_date); });
+    screen_location = lv_obj_create(NULL);  ui_builder_push([](void*) { create_location_screen(screen_location); });
+    screen_display = lv_obj_create(NULL);   ui_builder_push([](void*) { create_display_screen(screen_display); });
+
+    panel_register_screen("home", &ui_HomeScreen);
+    panel_register_screen("notifications", &screen_notifications);
+    panel_register_screen("settings", &screen_settings_menu);
+    panel_register_screen("wifi", &screen_wifi);
+    panel_register_screen("power", &screen_power);
+    panel_register_screen("ha", &screen_ha);
+    panel_register_screen("about", &screen_about);
+    panel_register_screen("time_date", &screen_time_date);
+    panel_register_screen("location", &screen_location);
+    panel_register_screen("display", &screen_display);
 
     if (ui_IconWeather != NULL) {
         lv_obj_add_flag(ui_IconWeather, LV_OBJ_FLAG_HIDDEN);
@@ -2948,6 +3072,7 @@ void setup() {
     lv_obj_add_event_cb(screen_settings_menu, swipe_event_cb, LV_EVENT_GESTURE, NULL);
 
     lv_scr_load(ui_HomeScreen);
+    setup_sched();
     // Note: clock_label is legacy, replaced by ui_time in handle_clock_update
     // clock_label = lv_label_create(ui_HomeScreen); ...
 
@@ -2959,7 +3084,7 @@ void setup() {
         if(cont_wifi_inputs) lv_obj_clear_flag(cont_wifi_inputs, LV_OBJ_FLAG_HIDDEN);
         
         if (strlen(wifi_ssid) > 0) {
-            Serial.println("Restoring WiFi Connection...");
+            LOG_I("Restoring WiFi Connection...");
             WiFi.mode(WIFI_STA);
             WiFi.begin(wifi_ssid, wifi_pass);
             wifiClient.setTimeout(500);
@@ -2986,13 +3111,13 @@ void setup() {
 
     refresh_saved_wifi_list_ui();
 
+    setup_mqtt_routes();
     if (strlen(mqtt_host) > 0 && mqtt_port > 0) {
         mqtt.setServer(mqtt_host, mqtt_port);
         mqtt.setCallback(mqtt_callback);
 
-        mqtt.setBufferSize(4096);
+        mqtt.setBufferSize(MQTT_BUFFER_SIZE);
     }
-    mqtt_retry_count = 0; 
     last_touch_ms = millis();
     last_wifi_check = millis();
 }
@@ -3003,165 +3128,99 @@ void handle_weather_timer() {
     static uint32_t last_weather_update = 0;
     // Update every 30 mins (1800000 ms) if WiFi is connected and Auto is ON
     if (WiFi.status() == WL_CONNECTED && (millis() - last_weather_update > 1800000)) {
-        Serial.println("30-min Weather Refresh Triggered");
+        LOG_I("30-min Weather Refresh Triggered");
         last_weather_update = millis();
-        trigger_weather_update = true;
+        request_weather_update();
     }
 }
 
 void handle_clock_update() {
-    if (millis() - lastMillis > 1000) {
-        lastMillis = millis();
-        RTC_DateTime dt = rtc.getDateTime();
-        
-        if (lv_scr_act() == screen_about) update_about_text();
-        
-        // 1. Update HOME SCREEN Text
-        if (ui_time) { 
-            char buf[10]; snprintf(buf, sizeof(buf), "%02d:%02d", dt.getHour(), dt.getMinute());
-            lv_label_set_text(ui_time, buf);
-        }
-        if (ui_date) { 
-             const char* days[] = {"Sat", "Sun", "Mon", "Tue", "Wed", "Thu", "Fri"};
-             char buf[32];
-             int wd = getDayOfWeek(dt.getDay(), dt.getMonth(), dt.getYear());
-             snprintf(buf, sizeof(buf), "%s, %02d/%02d", days[wd], dt.getDay(), dt.getMonth());
-             lv_label_set_text(ui_date, buf);
-        }
-        
-        // Update Home Screen Weather Text
-        if (ui_temp) lv_label_set_text(ui_temp, (String(current_temp, 0) + "°").c_str());
-        if (ui_loc) lv_label_set_text(ui_loc, sysLoc.city);
-        if (ui_cli) lv_label_set_text(ui_cli, get_weather_description(weather_code).c_str());
-
-        // 2. Update SLEEP SCREEN Text
-        if (ui_SleepScreen) {
-            int h = dt.getHour();
-            const char* ampm = (h >= 12) ? "PM" : "AM";
-            if (h == 0) h = 12; else if (h > 12) h -= 12;
-            int m = dt.getMonth(); if (m < 1) m = 1; if (m > 12) m = 12;
-
-            char buf[20], buf_sleep[20], date[20];
-            snprintf(buf, sizeof(buf), "%02d:%02d %s", h, dt.getMinute(), ampm);
-            snprintf(buf_sleep, sizeof(buf_sleep), "%02d:%02d", h, dt.getMinute()); 
-            snprintf(date, sizeof(date), "%02d %s %04d", dt.getDay(), monthNames[m-1], dt.getYear());
-
-            if(ui_LabelTime) lv_label_set_text(ui_LabelTime, buf_sleep);
-            if(ui_LabelDate) lv_label_set_text(ui_LabelDate, date);
-            
-            if(ui_LabelTemp) {
-                 String t = String(current_temp, 0) + "°";
-                 lv_label_set_text(ui_LabelTemp, t.c_str());
-            }
-            if(ui_LabelCity) {
-                 lv_label_set_text(ui_LabelCity, sysLoc.city);
-            }
-            
-            // Handle Alerts Badge
-            int count = get_notification_count();
-            if (ui_AlertsLabel != NULL) {
-                if (count > 0) {
-                    lv_obj_clear_flag(ui_AlertsLabel, LV_OBJ_FLAG_HIDDEN);
-                    String n = String(LV_SYMBOL_BELL) + "  " + String(count) + " Alerts";
-                    lv_label_set_text(ui_AlertsLabel, n.c_str());
-                } else {
-                    lv_obj_add_flag(ui_AlertsLabel, LV_OBJ_FLAG_HIDDEN);
-                }
-            }
-        }
+    RTC_DateTime dt = rtc.getDateTime();
+    
+    if (lv_scr_act() == screen_about) update_about_text();
+    
+    // Labels go through ui_bind: most seconds nothing changes and nothing redraws
+    // 1. Update HOME SCREEN Text
+    ui_bind_text_fmt(ui_time, "%02d:%02d", dt.getHour(), dt.getMinute());
+    if (ui_date) { 
+         const char* days[] = {"Sat", "Sun", "Mon", "Tue", "Wed", "Thu", "Fri"};
+         int wd = getDayOfWeek(dt.getDay(), dt.getMonth(), dt.getYear());
+         ui_bind_text_fmt(ui_date, "%s, %02d/%02d", days[wd], dt.getDay(), dt.getMonth());
+    }
+    
+    // Update Home Screen Weather Text
+    FixedString<16> temp;
+    temp.appendf("%.0f°", current_temp);
+    ui_bind_text(ui_temp, temp.c_str());
+    ui_bind_text(ui_loc, sysLoc.city);
+    ui_bind_text(ui_cli, get_weather_description(weather_code));
+
+    // 2. Update SLEEP SCREEN Text
+    if (ui_SleepScreen) {
+        int h = dt.getHour();
+        if (h == 0) h = 12; else if (h > 12) h -= 12;
+        int m = dt.getMonth(); if (m < 1) m = 1; if (m > 12) m = 12;
+
+        ui_bind_text_fmt(ui_LabelTime, "%02d:%02d", h, dt.getMinute());
+        ui_bind_text_fmt(ui_LabelDate, "%02d %s %04d", dt.getDay(), monthNames[m-1], dt.getYear());
+        ui_bind_text(ui_LabelTemp, temp.c_str());
+        ui_bind_text(ui_LabelCity, sysLoc.city);
         
-        // 3. Update Icons for BOTH screens using shared logic
-        update_status_icons(); 
+        // Handle Alerts Badge
+        int count = get_notification_count();
+        ui_bind_hidden(ui_AlertsLabel, count == 0);
+        if (count > 0) ui_bind_text_fmt(ui_AlertsLabel, LV_SYMBOL_BELL "  %d Alerts", count);
     }
+    
+    // 3. Update Icons for BOTH screens using shared logic
+    update_status_icons(); 
+}
+
+// Icon and its text twin share a color
+static void set_icon_color(lv_obj_t* icon, lv_obj_t* twin, lv_color_t color) {
+    ui_bind_text_color(icon, color);
+    ui_bind_text_color(twin, color);
 }
 
 void update_status_icons() {
     // WiFi Icon
     if (ui_IconWifi != NULL) {
-        if(current_wifi_state == WIFI_CONNECTED) {
-            lv_obj_set_style_text_color(ui_IconWifi, lv_color_white(), 0);
-            lv_obj_set_style_text_color(ui_wifi, lv_color_white(), 0);
-        }
-        else if (current_wifi_state == WIFI_CONNECTING) {
-            lv_obj_set_style_text_color(ui_IconWifi, lv_palette_main(LV_PALETTE_ORANGE), 0);
-            lv_obj_set_style_text_color(ui_wifi, lv_palette_main(LV_PALETTE_ORANGE), 0);
-        }
-        else {
-            lv_obj_set_style_text_color(ui_IconWifi, lv_palette_main(LV_PALETTE_RED), 0);
-            lv_obj_set_style_text_color(ui_wifi, lv_palette_main(LV_PALETTE_RED), 0);
-        }
+        if(current_wifi_state == WIFI_CONNECTED) set_icon_color(ui_IconWifi, ui_wifi, lv_color_white());
+        else if (current_wifi_state == WIFI_CONNECTING) set_icon_color(ui_IconWifi, ui_wifi, lv_palette_main(LV_PALETTE_ORANGE));
+        else set_icon_color(ui_IconWifi, ui_wifi, lv_palette_main(LV_PALETTE_RED));
     }
     // MQTT Icon
     if (ui_IconMqtt != NULL) {
-        if (mqtt_enabled && mqtt.connected()) {
-            lv_obj_set_style_text_color(ui_IconMqtt, lv_color_white(), 0);
-            lv_obj_set_style_text_color(ui_mqtt, lv_color_white(), 0);
-        } else if (mqtt_enabled) {
-            lv_obj_set_style_text_color(ui_IconMqtt, lv_palette_main(LV_PALETTE_ORANGE), 0);
-            lv_obj_set_style_text_color(ui_mqtt, lv_palette_main(LV_PALETTE_ORANGE), 0);
-        } else {
-            lv_obj_set_style_text_color(ui_IconMqtt, lv_palette_main(LV_PALETTE_RED), 0);
-            lv_obj_set_style_text_color(ui_mqtt, lv_palette_main(LV_PALETTE_RED), 0);
-        }
+        if (mqtt_enabled && mqtt_link_ready()) set_icon_color(ui_IconMqtt, ui_mqtt, lv_color_white());
+        else if (mqtt_enabled) set_icon_color(ui_IconMqtt, ui_mqtt, lv_palette_main(LV_PALETTE_ORANGE));
+        else set_icon_color(ui_IconMqtt, ui_mqtt, lv_palette_main(LV_PALETTE_RED));
     }
     // Battery Icon
     if (ui_IconBat != NULL) {
-        if (power.isBatteryConnect()) {
-            int pct = power.getBatteryPercent();
-            String batText = "";
-            if (pct > 95) {
-                lv_obj_set_style_text_color(ui_IconBat, lv_color_white(), 0);
-                lv_obj_set_style_text_color(ui_batt, lv_color_white(), 0);
-                batText = String(LV_SYMBOL_BATTERY_FULL);
-            }
-            else if (pct > 70 && pct <= 95) {
-                lv_obj_set_style_text_color(ui_IconBat, lv_color_white(), 0);
-                lv_obj_set_style_text_color(ui_batt, lv_color_white(), 0);
-                batText = String(LV_SYMBOL_BATTERY_3);
+        const char* batText = LV_SYMBOL_USB;
+        lv_color_t batColor = lv_color_white();
+        const PanelPowerSample& ps = panel_sample.power;
+        if (ps.present) {
+            int pct = ps.percent;
+            if (pct > 95) batText = LV_SYMBOL_BATTERY_FULL;
+            else if (pct > 70) batText = LV_SYMBOL_BATTERY_3;
+            else if (pct > 40) batText = LV_SYMBOL_BATTERY_2;
+            else if (pct > 15) { batText = LV_SYMBOL_BATTERY_1; batColor = lv_palette_main(LV_PALETTE_YELLOW); }
+            else if (pct > 5) { batText = LV_SYMBOL_BATTERY_1; batColor = lv_palette_main(LV_PALETTE_RED); }
+            else { batText = LV_SYMBOL_BATTERY_EMPTY; batColor = lv_palette_main(LV_PALETTE_RED); }
+            if(ps.charging) {
+                batText = LV_SYMBOL_CHARGE;
+                batColor = lv_palette_main(LV_PALETTE_YELLOW);
             }
-            else if (pct > 40 && pct <= 70) {
-                lv_obj_set_style_text_color(ui_IconBat, lv_color_white(), 0);
-                lv_obj_set_style_text_color(ui_batt, lv_color_white(), 0);
-                batText = String(LV_SYMBOL_BATTERY_2);
-            }
-            else if (pct > 15 && pct <= 40) {
-                lv_obj_set_style_text_color(ui_IconBat, lv_palette_main(LV_PALETTE_YELLOW), 0);
-                lv_obj_set_style_text_color(ui_batt, lv_palette_main(LV_PALETTE_YELLOW), 0);
-                batText = String(LV_SYMBOL_BATTERY_1);
-            }
-            else if (pct > 5 && pct <= 15) {
-                lv_obj_set_style_text_color(ui_IconBat, lv_palette_main(LV_PALETTE_RED), 0);
-                lv_obj_set_style_text_color(ui_batt, lv_palette_main(LV_PALETTE_RED), 0);
-                batText = String(LV_SYMBOL_BATTERY_1);
-            } else {
-                lv_obj_set_style_text_color(ui_IconBat, lv_palette_main(LV_PALETTE_RED), 0);
-                lv_obj_set_style_text_color(ui_batt, lv_palette_main(LV_PALETTE_RED), 0);
-                batText = String(LV_SYMBOL_BATTERY_EMPTY);
-            }
-            if(power.isCharging()) {
-                lv_obj_set_style_text_color(ui_IconBat, lv_palette_main(LV_PALETTE_YELLOW), 0);
-                lv_obj_set_style_text_color(ui_batt, lv_palette_main(LV_PALETTE_YELLOW), 0);
-                batText = String(LV_SYMBOL_CHARGE);
-            }
-            lv_label_set_text(ui_IconBat, batText.c_str());
-            lv_label_set_text(ui_batt, batText.c_str());
-        } else {
-            lv_obj_set_style_text_color(ui_IconBat, lv_color_white(), 0);
-            lv_obj_set_style_text_color(ui_batt, lv_color_white(), 0);
-            lv_label_set_text(ui_IconBat, LV_SYMBOL_USB);
-            lv_label_set_text(ui_batt, LV_SYMBOL_USB);
         }
+        set_icon_color(ui_IconBat, ui_batt, batColor);
+        ui_bind_text(ui_IconBat, batText);
+        ui_bind_text(ui_batt, batText);
     }
 
     // --- NEW: Update Bell Icon Color ---
     int count = get_notification_count();
-    if (ui_bell) {
-        if (count > 0) {
-            lv_obj_set_style_text_color(ui_bell, lv_palette_main(LV_PALETTE_ORANGE), 0);
-        } else {
-            lv_obj_set_style_text_color(ui_bell, lv_color_white(), 0);
-        }
-    }
+    ui_bind_text_color(ui_bell, count > 0 ? lv_palette_main(LV_PALETTE_ORANGE) : lv_color_white());
 }
 
 void handle_display_state() {
@@ -3199,36 +3258,25 @@ void handle_display_state() {
 void handle_wifi_state() {
     switch (current_wifi_state) {
         case WIFI_SCANNING:
-            lv_timer_handler(); delay(50);
+            lv_refr_now(NULL); delay(50);
             WiFi.disconnect(); WiFi.mode(WIFI_STA); delay(100);
             {
                 int n = WiFi.scanNetworks(false, false); 
 
                 if(scan_list_ui) {
-                    lv_obj_clean(scan_list_ui);
-                    lv_obj_t * btn_cancel = lv_list_add_btn(scan_list_ui, LV_SYMBOL_CLOSE, " Close");
-                    lv_obj_set_style_bg_color(btn_cancel, lv_palette_lighten(LV_PALETTE_GREY, 3), 0); 
-                    lv_obj_set_style_text_color(btn_cancel, lv_color_black(), 0);
-                    lv_obj_add_event_cb(btn_cancel, [](lv_event_t* e){ wipe_wifi_popup(); }, LV_EVENT_CLICKED, NULL);
-
                     if (n == 0) {
-                        lv_obj_t * txt = lv_list_add_text(scan_list_ui, "No networks found");
-                        lv_obj_set_style_text_color(txt, lv_palette_main(LV_PALETTE_GREY), 0);
+                        scan_list_reset("No networks found", lv_palette_main(LV_PALETTE_GREY), true);
                         if(lbl_wifi_status) lv_label_set_text(lbl_wifi_status, "Status: None Found");
                     } else if (n > 0) {
-                        lv_obj_t * txt = lv_list_add_text(scan_list_ui, "Select Network:");
-                        lv_obj_set_style_bg_color(txt, lv_palette_lighten(LV_PALETTE_GREY, 3), 0); 
-                        lv_obj_set_style_text_color(txt, lv_color_black(), 0);
+                        scan_list_reset("Select Network:", lv_color_black(), true);
+                        uint32_t rows = 0;
                         for (int i = 0; i < n; ++i) {
                             String ssidName = WiFi.SSID(i);
                             if(ssidName.length() > 0) {
-                                lv_obj_t *btn = lv_list_add_btn(scan_list_ui, LV_SYMBOL_WIFI, ssidName.c_str());
-                                lv_obj_set_style_text_color(btn, lv_color_black(), 0);
-                                lv_obj_set_style_bg_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 3), 0);
-                                lv_obj_set_style_border_side(btn, LV_BORDER_SIDE_BOTTOM, 0);
-                                lv_obj_set_style_border_width(btn, 1, 0);
-                                lv_obj_set_style_border_color(btn, lv_palette_lighten(LV_PALETTE_GREY, 4), 0);
-                                lv_obj_add_event_cb(btn, wifi_list_btn_cb, LV_EVENT_CLICKED, NULL);
+                                lv_obj_t *btn = obj_pool_row(&scan_row_pool, scan_list_ui, rows, 2);
+                                if (!btn) break;
+                                ui_bind_text(lv_obj_get_child(btn, -1), ssidName.c_str());
+                                rows++;
                             }
                         }
                         if(lbl_wifi_status) {
@@ -3236,8 +3284,7 @@ void handle_wifi_state() {
                             lv_obj_set_style_text_color(lbl_wifi_status, lv_palette_main(LV_PALETTE_GREEN), 0);
                         }
                     } else {
-                        lv_obj_t * txt = lv_list_add_text(scan_list_ui, "Scan Failed");
-                        lv_obj_set_style_text_color(txt, lv_palette_main(LV_PALETTE_RED), 0);
+                        scan_list_reset("Scan Failed", lv_palette_main(LV_PALETTE_RED), true);
                         if(lbl_wifi_status) lv_label_set_text(lbl_wifi_status, "Status: Error");
                     }
                 }
@@ -3262,20 +3309,21 @@ void handle_wifi_state() {
                     if (ntp_auto_update && getLocalTime(&ti, 2000)) { 
                         rtc.setDateTime(ti.tm_year + 1900, ti.tm_mon + 1, ti.tm_mday, ti.tm_hour, ti.tm_min, ti.tm_sec);
                     } else {
-                        Serial.println("NTP Sync delayed, proceeding with Weather fetch...");
+                        LOG_W("NTP Sync delayed, proceeding with Weather fetch...");
                     }
 
-                    trigger_weather_update = true;
+                    request_weather_update();
+                    sensor_sampler_refresh();       // New SSID and IP
 
                     if (strlen(mqtt_host) > 0) {
-                        mqtt_enabled = true; mqtt_retry_count = 0;
+                        mqtt_enabled = true; mqtt_link_reset();
                         if(sw_mqtt_enable) lv_obj_add_state(sw_mqtt_enable, LV_STATE_CHECKED);
                         if(cont_ha_inputs) lv_obj_clear_flag(cont_ha_inputs, LV_OBJ_FLAG_HIDDEN);
                         prefs.begin("sys_config", false); prefs.putBool("mqtt_en", true); prefs.end();
                     }
                 } 
                 else if (status == WL_CONNECT_FAILED) {
-                    Serial.println("WiFi Auth Failed. Disabling to prevent glitches.");
+                    LOG_W("WiFi Auth Failed. Disabling to prevent glitches.");
                     hide_loader();
                     WiFi.disconnect();
                     current_wifi_state = WIFI_IDLE;
@@ -3311,7 +3359,7 @@ void handle_wifi_state() {
             if (wifi_enabled && WiFi.status() != WL_CONNECTED) {
                 if (millis() - last_wifi_check > WIFI_RECONNECT_INTERVAL) {
                     last_wifi_check = millis();
-                    Serial.println("Auto-reconnecting WiFi...");
+                    LOG_I("Auto-reconnecting WiFi...");
                     WiFi.begin(wifi_ssid, wifi_pass);
                     current_wifi_state = WIFI_CONNECTING;
                     wifi_connect_start = millis();
@@ -3324,110 +3372,95 @@ void handle_wifi_state() {
             if(WiFi.status() != WL_CONNECTED) {
                 current_wifi_state = WIFI_CONNECTING; 
                 wifi_connect_start = millis(); 
-                mqtt.disconnect(); 
+                mqtt_link_stop();
             }
             break;
     }
 }
 
+// Runs only while screen_ha is loaded (see setup_sched). Goes through ui_bind,
+// so an idle status screen does not redraw.
 void handle_ha_screen_ui() {
-    // Only run this if we are currently looking at the HA screen
-    if (lv_scr_act() == screen_ha && lbl_ha_status) {
-        if (!mqtt_enabled) {
-            const char* cur_txt = lv_label_get_text(lbl_ha_status);
-            // Don't overwrite error messages (like "Connection Failed")
-            if(strstr(cur_txt, "Error") == NULL) {
-                lv_label_set_text(lbl_ha_status, "Status: Disabled");
-                lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_GREY), 0);
-            }
+    if (!lbl_ha_status) return;
+    const char* cur_txt = lv_label_get_text(lbl_ha_status);
+    char txt[40];
+    lv_palette_t color = LV_PALETTE_ORANGE;
+
+    if (!mqtt_enabled) {
+        // Don't overwrite error messages (like "Connection Failed")
+        if (strstr(cur_txt, "Error") != NULL) return;
+        snprintf(txt, sizeof(txt), "Status: Disabled");
+        color = LV_PALETTE_GREY;
+    } else {
+        uint32_t retry_in = mqtt_link_retry_in();
+        if (mqtt_link_ready()) {
+            snprintf(txt, sizeof(txt), "Status: Connected");
+            color = LV_PALETTE_GREEN;
+        } else if (!mqtt_link_busy && retry_in > 0) {
+            snprintf(txt, sizeof(txt), "Status: Retrying in %lus", (unsigned long)(retry_in + 999) / 1000);
         } else {
-            if (mqtt.connected()) {
-                lv_label_set_text(lbl_ha_status, "Status: Connected");
-                lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_GREEN), 0);
-            } else {
-                lv_label_set_text(lbl_ha_status, "Status: Connecting...");
-                lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_ORANGE), 0);
-            }
+            snprintf(txt, sizeof(txt), "Status: Connecting...");
         }
     }
+    ui_bind_text(lbl_ha_status, txt);
+    ui_bind_text_color(lbl_ha_status, lv_palette_main(color));
 }
 
 void handle_mqtt_loop() {
-    if (current_wifi_state == WIFI_CONNECTED && mqtt_enabled) {
-        if (!mqtt.connected()) {
-            if (millis() - last_mqtt_retry > 2000) {
-                last_mqtt_retry = millis();
-                
-                if (mqtt_retry_count >= 3) {
-                    Serial.println("MQTT Failed. Disabling.");
-                    mqtt_enabled = false; mqtt_retry_count = 0; 
-                    prefs.begin("sys_config", false); prefs.putBool("mqtt_en", false); prefs.end();
-                    if(lbl_ha_status) {
-                        lv_label_set_text(lbl_ha_status, "Status: Disabled (Failed)");
-                        lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_RED), 0);
-                    }
-                    add_notification("MQTT Failed: Disabled");
-                } else {
-                    mqtt_retry_count++;
-                    if(lbl_ha_status) {
-                        lv_label_set_text(lbl_ha_status, "Status: Connecting...");
-                        lv_obj_set_style_text_color(lbl_ha_status, lv_palette_main(LV_PALETTE_ORANGE), 0);
-                    }
-                    wifiClient.setTimeout(1000); 
-                    bool connected = (strlen(mqtt_user) > 0) ? mqtt.connect("esp32_panel", mqtt_user, mqtt_pass) : mqtt.connect("esp32_panel");
-                    
-                    if(connected) {
-                        Serial.println("MQTT Success!");
-                        mqtt_retry_count = 0;
-
-                        show_loader("Syncing States...");
+    if (current_wifi_state != WIFI_CONNECTED || !mqtt_enabled) return;
 
-                        mqtt.subscribe("ha/panel/config/set");
-                        mqtt.subscribe("ha/panel/state/update");
-                        mqtt.subscribe(mqtt_topic_notify);
-
-                        mqtt.publish("ha/panel/sync", "get_states");
-                        delay(500);
-                        hide_loader();
-                    }
-                }
+    switch (mqtt_link_process()) {
+        case MQTT_LINK_CONNECTED:
+            mqtt_report_failure = false;
+            panel_codec_announce();
+            break;
+        case MQTT_LINK_FAILED:
+            // Keeps retrying in the background; only the first failure after
+            // the user saved new settings is worth a popup.
+            if (mqtt_report_failure) {
+                mqtt_report_failure = false;
+                show_notification_popup("MQTT: Connection Failed.\nCheck Host IP/User.\nRetrying in background.", -1);
             }
-        } else {
-            mqtt.loop();
-            mqtt_retry_count = 0; 
-        }
+            break;
+        default:
+            break;
     }
 }
 
+// Runs only while screen_power is loaded (see setup_sched)
 void update_power_screen_ui() {
-    if (lv_scr_act() == screen_power) {
+    if (power_info_label) {
       char pwr_buf[256];
       char net_buf[128];
-      char mqtt_buf[128];
-      char final_buf[512];
-      bool isPluggedIn = (power.getVbusVoltage() > 4000);
-      bool isBatteryConnected = power.isBatteryConnect();
+      char mqtt_buf[192];
+      char pool_buf[192];
+      char lat_buf[256];
+      char final_buf[1024];
+      const PanelPowerSample& ps = panel_sample.power;
+      const PanelNetSample& ns = panel_sample.net;
+      bool isPluggedIn = ps.usb;
+      bool isBatteryConnected = ps.present;
       
       if (isPluggedIn) {
           if (isBatteryConnected) {
               snprintf(pwr_buf, sizeof(pwr_buf), 
                   "POWER STATUS:\nSource: USB Power\nBattery: %d%%\nStatus: %s\nVBUS: %u mV", 
-                  power.getBatteryPercent(),
-                  power.isCharging() ? "Charging " LV_SYMBOL_CHARGE : "Fully Charged",
-                  power.getVbusVoltage()
+                  ps.percent,
+                  ps.charging ? "Charging " LV_SYMBOL_CHARGE : "Fully Charged",
+                  ps.vbus_mv
               );
           } else {
               snprintf(pwr_buf, sizeof(pwr_buf), 
                   "POWER STATUS:\nSource: USB Power\nBattery: Disconnected\nStatus: System Active\nVBUS: %u mV", 
-                  power.getVbusVoltage()
+                  ps.vbus_mv
               );
           }
       } else {
           if (isBatteryConnected) {
               snprintf(pwr_buf, sizeof(pwr_buf), 
                   "POWER STATUS:\nSource: Battery\nLevel: %d%%\nVoltage: %u mV\nStatus: Discharging", 
-                  power.getBatteryPercent(),
-                  power.getBattVoltage()
+                  ps.percent,
+                  ps.mv
               );
           } else {
               snprintf(pwr_buf, sizeof(pwr_buf), 
@@ -3437,14 +3470,14 @@ void update_power_screen_ui() {
       }
 
       if(current_wifi_state == WIFI_CONNECTED) {
-          long rssi = WiFi.RSSI();
+          long rssi = ns.rssi;
           int quality = 2 * (rssi + 100);
           if (quality > 100) quality = 100; if (quality < 0) quality = 0;
           
           snprintf(net_buf, sizeof(net_buf), 
               "\nNETWORK STATUS:\nWiFi: Connected\nSSID: %s\nIP: %s\nSignal: %d%%",
-              WiFi.SSID().c_str(),
-              WiFi.localIP().toString().c_str(),
+              ns.ssid,
+              ns.ip,
               quality
           );
       } else {
@@ -3453,81 +3486,141 @@ void update_power_screen_ui() {
 
       if (!mqtt_enabled) {
           snprintf(mqtt_buf, sizeof(mqtt_buf), "\nMQTT STATUS:\nState: Disabled");
-      } else if (mqtt.connected()) {
+      } else if (mqtt_link_ready()) {
           snprintf(mqtt_buf, sizeof(mqtt_buf), 
-              "\nMQTT STATUS:\nState: Connected\nBroker: %s", 
-              mqtt_host
+              "\nMQTT STATUS:\nState: Connected\nBroker: %s\nUI updates: %lu (%lu coalesced)", 
+              mqtt_host, (unsigned long)grid_state_updates, (unsigned long)grid_state_coalesced
           );
       } else {
           snprintf(mqtt_buf, sizeof(mqtt_buf), "\nMQTT STATUS:\nState: Connecting...");
       }
 
-      snprintf(final_buf, sizeof(final_buf), "%s\n%s\n%s", pwr_buf, net_buf, mqtt_buf);      
+      int n = snprintf(pool_buf, sizeof(pool_buf), "\nUI POOLS (live/size, max):\n");
+      const ObjPool* pools[] = { &chip_pool, &notification_pool, &saved_wifi_pool, &scan_row_pool };
+      for (const ObjPool* p : pools) {
+          if (n < (int)sizeof(pool_buf)) n += obj_pool_format(pool_buf + n, sizeof(pool_buf) - n, p);
+      }
+
+      latency_format(lat_buf, sizeof(lat_buf));
+
+      snprintf(final_buf, sizeof(final_buf), "%s\n%s\n%s\n%s\n%s", pwr_buf, net_buf, mqtt_buf, pool_buf, lat_buf);      
       lv_label_set_text(power_info_label, final_buf);
   }
 }
 
-// --- MAIN LOOP ---
+// --- SCHEDULED TASKS ---
+// Everything below runs from LVGL timers created in setup_sched(). Signal
+// tasks replace the flags loop() used to poll; periodic tasks keep the rate
+// each job actually needs instead of running on every pass.
 
-void loop() {
-    lv_timer_handler();
-    delay(5);
-
-    // --- NEW: Handle UI Updates safely in main loop ---
-    if (config_update_pending) {
-        // Now it's safe to allocate memory and build UI
-        refresh_ui_data(pending_json_config.c_str());
-        pending_json_config = ""; // Clear memory
-        config_update_pending = false;
-    }
-
-    // 1. Weather/Time Sync Trigger
-    if (trigger_weather_update) {
-        struct tm ti;
-        if (getLocalTime(&ti, 100)) { 
-            rtc.setDateTime(ti.tm_year + 1900, ti.tm_mon + 1, ti.tm_mday, ti.tm_hour, ti.tm_min, ti.tm_sec);
-            if (lv_scr_act() == screen_time_date) time_screen_load_cb(NULL);
-        }
-        fetch_weather_data();
-        trigger_weather_update = false;
-    }
+// Apply a config received over MQTT (signalled by on_config_set_msg)
+void config_apply_task() {
+    if (!config_update_pending) return;
+    // Now it's safe to allocate memory and build UI
+    HEAP_DEBUG_BEGIN("config");     // Ends once the UI builder has drained
+    refresh_ui_data(pending_config, pending_config_len);
+    panel_arena_free(&net_arena, pending_config); // Clear memory
+    pending_config = NULL;
+    config_update_pending = false;
+}
 
-    // 2. UI Cleanup
-    if (notification_ui_dirty) {
-        refresh_notification_list();
-        notification_ui_dirty = false;
+// Weather/Time Sync (signalled by request_weather_update)
+void weather_fetch_task() {
+    if (!trigger_weather_update) return;
+    struct tm ti;
+    if (getLocalTime(&ti, 100)) { 
+        rtc.setDateTime(ti.tm_year + 1900, ti.tm_mon + 1, ti.tm_mday, ti.tm_hour, ti.tm_min, ti.tm_sec);
+        if (lv_scr_act() == screen_time_date) time_screen_load_cb(NULL);
     }
+    fetch_weather_data();
+    trigger_weather_update = false;
+}
+
+// Notification list rebuild (signalled by mark_notifications_dirty)
+void notification_refresh_task() {
+    if (!notification_ui_dirty) return;
+    HEAP_DEBUG_BEGIN("notifications");
+    refresh_notification_list();
+    HEAP_DEBUG_END("notifications");
+    notification_ui_dirty = false;
+}
 
-    // 3. Popup Auto-close
+void popup_autoclose_task() {
     if (msg_popup != NULL && (millis() - popup_start_time > 10000)) {
-        Serial.println("Auto-closing popup");
+        LOG_D("Auto-closing popup");
         lv_obj_del(msg_popup);
         msg_popup = NULL;
         selected_notification_index = -1;
         last_touch_ms = millis(); 
     }
+}
 
-    // 4. Sensors
-    check_sensor_logic();
-
-    // 5. Display State Machine (Sleep/Saver/Active)
-    handle_display_state();
+// MQTT has no readiness callback, so the client is polled every MQTT_POLL_MS.
+// PubSubClient reads one packet per call; while the socket still holds data the
+// task runs again on the next pass instead of waiting out the period.
+#define MQTT_POLL_MS  50
 
-    // 6. WiFi State Machine
-    handle_wifi_state();
+lv_timer_t* net_task_timer = NULL;
+lv_timer_t* cmd_task = NULL;        // Runs only while commands are queued
 
-    // 7. MQTT Logic
+void net_task() {
     handle_mqtt_loop();
-    
-    // 8. Background Timers (Weather Auto-Refresh)
-    handle_weather_timer();
+    diag_process();
+    if (mqtt_link_has_input()) lv_timer_ready(net_task_timer);
+}
 
-    // 9. Clock & Icons Update
-    handle_clock_update();
+// Pings and periodic publishes, all on intervals of seconds
+void net_slow_task() {
+    latency_process();
+    telemetry_process();
+}
 
-    // 10. Specific Screen UI Updates
-    handle_ha_screen_ui();
-    
-    // 11. Info Screen Update (Only if active)
-    update_power_screen_ui();
-}
\ No newline at end of file
+void cmd_task_fn() {
+    cmd_queue_process();
+    if (cmd_queue_empty()) lv_timer_pause(cmd_task);
+}
+
+static void cmd_queue_wake() {
+    sched_signal(cmd_task);
+}
+
+void setup_sched() {
+    sensor_sampler_init();
+    net_task_timer = sched_every(net_task, MQTT_POLL_MS);
+    sched_every(net_slow_task, 1000);
+    cmd_task = sched_every(cmd_task_fn, 25);   // Sends within 25 ms of the coalesce window closing
+    lv_timer_pause(cmd_task);
+    cmd_queue_wake_cb = cmd_queue_wake;
+    sched_every(handle_wifi_state, 100);
+    display_task = sched_every(handle_display_state, 100);
+    sched_every(check_sensor_logic, 50);       // Motion delta is per sample, keep close to the old rate
+    sched_every(handle_clock_update, 1000);
+    sched_every(popup_autoclose_task, 1000);
+    sched_every(handle_weather_timer, 5000);
+
+    config_task = sched_on_signal(config_apply_task);
+    weather_task = sched_on_signal(weather_fetch_task);
+    notification_task = sched_on_signal(notification_refresh_task);
+
+    sched_on_screen(screen_ha, handle_ha_screen_ui, 500);
+    sched_on_screen(screen_power, update_power_screen_ui, 1000);
+
+    // Flags raised before the tasks existed
+    if (config_update_pending) sched_signal(config_task);
+    if (trigger_weather_update) sched_signal(weather_task);
+    if (notification_ui_dirty) sched_signal(notification_task);
+}
+
+// --- MAIN LOOP ---
+
+void loop() {
+    telemetry_loop_mark();
+    uint32_t idle_ms = lv_timer_handler();    // Runs every task that is due
+    ui_builder_run();
+    if (!ui_builder_busy()) HEAP_DEBUG_END("config");
+    telemetry_loop_done();
+
+    // Sleep until the next deadline; keep going while the UI builder has work
+    if (ui_builder_busy()) delay(1);
+    else sched_idle(idle_ms);
+}
@@ -0,0 +1,220 @@
+#ifndef MQTT_LINK_H
+#define MQTT_LINK_H
+
+#include <WiFi.h>
+#include <PubSubClient.h>
+#include <time.h>
+#include "mqtt_router.h"
+#include "panel_log.h"
+
+extern PubSubClient mqtt;
+extern WiFiClient wifiClient;
+extern char mqtt_host[64];
+extern int  mqtt_port;
+extern char mqtt_user[32];
+extern char mqtt_pass[32];
+
+// --- MQTT CONNECTION MANAGER ---
+// mqtt.connect() blocks for the whole TCP + CONNECT handshake, so it runs in a
+// short-lived task on the other core while the UI keeps rendering. While that
+// task owns the client nothing else may touch `mqtt`; use mqtt_link_ready()
+// instead of mqtt.connected() outside this file.
+// Failed attempts back off exponentially (with jitter, capped at a minute) and
+// never give up. The session is persistent (fixed client ID, clean session off,
+// QoS 1 subscriptions), so the broker queues state updates while we are away
+// and a reconnect only asks HA for what changed since the link dropped.
+// The connect task works from its own copy of the broker settings, taken in
+// mqtt_link_start(), so the settings screen may rewrite mqtt_host/user/pass at
+// any time; the new values are picked up by the next attempt.
+
+#define MQTT_BACKOFF_MIN_MS   1000
+#define MQTT_BACKOFF_MAX_MS   60000
+#define MQTT_CONNECT_TIMEOUT  2000     // Socket timeout for the connect task
+#define MQTT_SUB_QOS          1
+#define MQTT_SYNC_SLACK_S     5        // Overlap for the delta sync, covers clock skew with HA
+#define MQTT_EPOCH_VALID      1700000000
+#define MQTT_STALE_MAX        4        // Old filters waiting to be unsubscribed
+
+enum MqttLinkEvent {
+    MQTT_LINK_NONE,
+    MQTT_LINK_CONNECTED,
+    MQTT_LINK_FAILED,
+    MQTT_LINK_LOST,
+};
+
+char mqtt_client_id[48];
+static char mqtt_link_host[64];           // Owned by the connect task while busy
+static char mqtt_link_user[32];
+static char mqtt_link_pass[32];
+static char mqtt_link_stale[MQTT_STALE_MAX][MQTT_FILTER_MAX];
+static uint8_t mqtt_link_stale_count = 0;
+volatile bool mqtt_link_busy = false;     // Connect task owns the client
+volatile bool mqtt_link_done = false;     // Task finished, result not collected yet
+volatile bool mqtt_link_ok = false;
+
+bool mqtt_link_up = false;                // Last state seen by the main loop
+uint32_t mqtt_link_connects = 0;          // Successful connects since boot
+uint32_t mqtt_link_failed_total = 0;      // Failed attempts since boot
+bool mqtt_link_synced_once = false;       // A full sync has been requested since boot
+uint32_t mqtt_link_lost_epoch = 0;        // When the link dropped (0 = unknown)
+uint16_t mqtt_link_failures = 0;
+uint32_t mqtt_link_next_try_ms = 0;
+bool mqtt_link_disconnect_pending = false;
+
+bool mqtt_link_ready() {
+    return !mqtt_link_busy && !mqtt_link_done && mqtt.connected();
+}
+
+// Bytes from the broker are waiting; PubSubClient reads one packet per loop()
+bool mqtt_link_has_input() {
+    return mqtt_link_ready() && wifiClient.available() > 0;
+}
+
+// Milliseconds until the next attempt, 0 if one may start now
+uint32_t mqtt_link_retry_in() {
+    int32_t d = (int32_t)(mqtt_link_next_try_ms - millis());
+    return d > 0 ? (uint32_t)d : 0;
+}
+
+static void mqtt_link_task(void* arg) {
+    const char* user = mqtt_link_user[0] ? mqtt_link_user : NULL;
+    const char* pass = mqtt_link_user[0] ? mqtt_link_pass : NULL;
+    mqtt_link_ok = mqtt.connect(mqtt_client_id, user, pass, NULL, 0, false, NULL, false);
+    mqtt_link_done = true;
+    mqtt_link_busy = false;
+    vTaskDelete(NULL);
+}
+
+// "Equal jitter": half the window is fixed, half random, so panels that lost
+// the broker together do not come back in lockstep.
+static void mqtt_link_schedule_retry() {
+    uint32_t window = MQTT_BACKOFF_MIN_MS;
+    for (uint16_t i = 0; i < mqtt_link_failures && window < MQTT_BACKOFF_MAX_MS; i++) window <<= 1;
+    if (window > MQTT_BACKOFF_MAX_MS) window = MQTT_BACKOFF_MAX_MS;
+    mqtt_link_next_try_ms = millis() + window / 2 + esp_random() % (window / 2 + 1);
+}
+
+static bool mqtt_link_start() {
+    snprintf(mqtt_client_id, sizeof(mqtt_client_id), "panel-%s", panel_device_id);
+    snprintf(mqtt_link_host, sizeof(mqtt_link_host), "%s", mqtt_host);
+    snprintf(mqtt_link_user, sizeof(mqtt_link_user), "%s", mqtt_user);
+    snprintf(mqtt_link_pass, sizeof(mqtt_link_pass), "%s", mqtt_pass);
+    mqtt.setServer(mqtt_link_host, mqtt_port);   // PubSubClient keeps the pointer
+    wifiClient.setTimeout(MQTT_CONNECT_TIMEOUT);
+
+    mqtt_link_done = false;
+    mqtt_link_busy = true;
+    if (xTaskCreatePinnedToCore(mqtt_link_task, "mqtt_conn", 6144, NULL, 1, NULL, 0) != pdPASS) {
+        mqtt_link_busy = false;
+        return false;
+    }
+    return true;
+}
+
+// Asks HA for states: everything on the first connect after boot, otherwise
+// only entities that changed while we were offline.
+static void mqtt_link_request_sync() {
+    if (mqtt_link_synced_once && mqtt_link_lost_epoch >= MQTT_EPOCH_VALID) {
+        char payload[32];
+        snprintf(payload, sizeof(payload), "{\"since\":%lu}", (unsigned long)(mqtt_link_lost_epoch - MQTT_SYNC_SLACK_S));
+        mqtt.publish("ha/panel/sync", payload);
+    } else {
+        mqtt.publish("ha/panel/sync", "get_states");
+    }
+    mqtt_link_synced_once = true;
+}
+
+// Drops the connection (now, or as soon as a running attempt finishes) and
+// clears the backoff so the next attempt starts right away.
+void mqtt_link_reset() {
+    if (mqtt_link_busy || mqtt_link_done) mqtt_link_disconnect_pending = true;
+    else mqtt.disconnect();
+    if (mqtt_link_up) {
+        mqtt_link_up = false;
+        time_t now = time(NULL);
+        mqtt_link_lost_epoch = now >= MQTT_EPOCH_VALID ? (uint32_t)now : 0;
+    }
+    mqtt_link_failures = 0;
+    mqtt_link_next_try_ms = millis();
+}
+
+// Called from loop() whenever MQTT should be up. Pumps the client, collects
+// connect results and starts new attempts when the backoff allows.
+MqttLinkEvent mqtt_link_process() {
+    if (mqtt_link_busy) return MQTT_LINK_NONE;
+
+    if (mqtt_link_done) {
+        mqtt_link_done = false;
+        if (mqtt_link_disconnect_pending) {
+            mqtt_link_disconnect_pending = false;
+            mqtt.disconnect();
+            return MQTT_LINK_NONE;
+        }
+        if (!mqtt_link_ok) {
+            mqtt_link_failures++;
+            mqtt_link_failed_total++;
+            mqtt_link_schedule_retry();
+            LOG_W("MQTT: connect failed (state %d), retry in %lu ms", mqtt.state(), (unsigned long)mqtt_link_retry_in());
+            return MQTT_LINK_FAILED;
+        }
+        LOG_I("MQTT: connected as %s", mqtt_client_id);
+        mqtt_link_up = true;
+        mqtt_link_failures = 0;
+        mqtt_link_connects++;
+        // The session outlives the connection: drop filters replaced while offline
+        for (uint8_t i = 0; i < mqtt_link_stale_count; i++) mqtt.unsubscribe(mqtt_link_stale[i]);
+        mqtt_link_stale_count = 0;
+        mqtt_router_subscribe_all(MQTT_SUB_QOS);
+        mqtt_link_request_sync();
+        return MQTT_LINK_CONNECTED;
+    }
+
+    if (mqtt_link_disconnect_pending) {
+        mqtt_link_disconnect_pending = false;
+        mqtt.disconnect();
+    }
+
+    if (mqtt.connected()) {
+        mqtt.loop();
+        return MQTT_LINK_NONE;
+    }
+
+    MqttLinkEvent ev = MQTT_LINK_NONE;
+    if (mqtt_link_up) {
+        mqtt_link_up = false;
+        time_t now = time(NULL);
+        mqtt_link_lost_epoch = now >= MQTT_EPOCH_VALID ? (uint32_t)now : 0;
+        mqtt_link_schedule_retry();
+        LOG_W("MQTT: connection lost");
+        ev = MQTT_LINK_LOST;
+    }
+    if (mqtt_link_retry_in() == 0 && mqtt_host[0] != '\0') mqtt_link_start();
+    return ev;
+}
+
+// Points route `idx` at a new topic (e.g. after the device name changed) and
+// moves the live subscription along with it. When offline the old filter is
+// remembered and unsubscribed on the next connect, since the persistent session
+// would otherwise keep delivering it.
+void mqtt_link_set_route_filter(int idx, const char* filter) {
+    if (idx < 0 || idx >= mqtt_route_count) return;
+    char old_filter[MQTT_FILTER_MAX];
+    snprintf(old_filter, sizeof(old_filter), "%s", mqtt_routes[idx].filter);
+    mqtt_router_set_filter(idx, filter);
+    if (strcmp(old_filter, mqtt_routes[idx].filter) == 0) return;
+    if (mqtt_link_ready()) {
+        mqtt.unsubscribe(old_filter);
+        mqtt.subscribe(mqtt_routes[idx].filter, MQTT_SUB_QOS);
+    } else if (mqtt_link_stale_count < MQTT_STALE_MAX) {
+        snprintf(mqtt_link_stale[mqtt_link_stale_count++], MQTT_FILTER_MAX, "%s", old_filter);
+    } else {
+        LOG_W("MQTT: too many topic changes offline, %s stays subscribed", old_filter);
+    }
+}
+
+// Called when MQTT is disabled or WiFi is down
+void mqtt_link_stop() {
+    if (mqtt_link_busy || mqtt_link_done || mqtt_link_up || mqtt.connected()) mqtt_link_reset();
+}
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef MQTT_ROUTER_H
+#define MQTT_ROUTER_H
+
+#include <PubSubClient.h>
+#include "panel_hash.h"
+#include "panel_arena.h"
+#include "panel_log.h"
+
+extern PubSubClient mqtt;
+
+// --- ROUTER LIMITS ---
+#define MQTT_ROUTE_MAX        16
+#define MQTT_ROUTE_BUCKETS    32    // Power of two, keep >= 2x MQTT_ROUTE_MAX
+#define MQTT_FILTER_MAX       96
+#define MQTT_INLINE_PAYLOAD   256   // Payloads up to this size never touch the heap
+
+// Handler receives the full topic, the part matched by a trailing wildcard
+// (e.g. the entity ID for "ha/panel/state/+", NULL for exact routes) and a
+// NUL-terminated copy of the payload.
+typedef void (*mqtt_route_cb_t)(const char* topic, const char* wildcard, char* payload, unsigned int len);
+
+struct MqttRoute {
+    char filter[MQTT_FILTER_MAX];
+    uint32_t hash;
+    mqtt_route_cb_t handler;
+};
+
+MqttRoute mqtt_routes[MQTT_ROUTE_MAX];
+int mqtt_route_count = 0;
+int8_t mqtt_route_table[MQTT_ROUTE_BUCKETS];
+
+// --- TABLE BUILD ---
+void mqtt_router_rebuild() {
+    memset(mqtt_route_table, -1, sizeof(mqtt_route_table));
+    for (int i = 0; i < mqtt_route_count; i++) {
+        mqtt_routes[i].hash = fnv1a(mqtt_routes[i].filter);
+        uint32_t b = mqtt_routes[i].hash & (MQTT_ROUTE_BUCKETS - 1);
+        while (mqtt_route_table[b] >= 0) b = (b + 1) & (MQTT_ROUTE_BUCKETS - 1);
+        mqtt_route_table[b] = (int8_t)i;
+    }
+}
+
+// Registers a handler. Wildcards are only supported as the last level
+// ("ha/panel/state/+" or "ha/panel/#"). Returns the route index, or -1 if full.
+int mqtt_router_on(const char* filter, mqtt_route_cb_t handler) {
+    if (mqtt_route_count >= MQTT_ROUTE_MAX) return -1;
+    MqttRoute* r = &mqtt_routes[mqtt_route_count];
+    snprintf(r->filter, sizeof(r->filter), "%s", filter);
+    r->handler = handler;
+    mqtt_route_count++;
+    mqtt_router_rebuild();
+    return mqtt_route_count - 1;
+}
+
+// Used when a configurable topic (e.g. the notify topic) changes at runtime.
+void mqtt_router_set_filter(int idx, const char* filter) {
+    if (idx < 0 || idx >= mqtt_route_count) return;
+    snprintf(mqtt_routes[idx].filter, sizeof(mqtt_routes[idx].filter), "%s", filter);
+    mqtt_router_rebuild();
+}
+
+void mqtt_router_subscribe_all(uint8_t qos = 0) {
+    for (int i = 0; i < mqtt_route_count; i++) {
+        mqtt.subscribe(mqtt_routes[i].filter, qos);
+    }
+}
+
+// --- LOOKUP ---
+static MqttRoute* mqtt_router_probe(uint32_t h, const char* topic, size_t prefix_len, char wildcard) {
+    uint32_t b = h & (MQTT_ROUTE_BUCKETS - 1);
+    for (int n = 0; n < MQTT_ROUTE_BUCKETS; n++) {
+        int8_t idx = mqtt_route_table[b];
+        if (idx < 0) return NULL;
+        MqttRoute* r = &mqtt_routes[idx];
+        if (r->hash == h) {
+            if (wildcard == 0) {
+                if (strcmp(r->filter, topic) == 0) return r;
+            } else if (strncmp(r->filter, topic, prefix_len) == 0 &&
+                       r->filter[prefix_len] == wildcard && r->filter[prefix_len + 1] == '\0') {
+                return r;
+            }
+        }
+        b = (b + 1) & (MQTT_ROUTE_BUCKETS - 1);
+    }
+    return NULL;
+}
+
+// Exact match first, then "<parent>/+", then "<ancestor>/#" walking up the tree.
+MqttRoute* mqtt_router_match(const char* topic, const char** wildcard_out) {
+    *wildcard_out = NULL;
+    MqttRoute* r = mqtt_router_probe(fnv1a(topic), topic, 0, 0);
+    if (r) return r;
+
+    size_t len = strlen(topic);
+    bool last_level = true;
+    for (size_t i = len; i > 0; i--) {
+        if (topic[i - 1] != '/') continue;
+        uint32_t h_prefix = fnv1a_n(topic, i);
+        if (last_level) {
+            r = mqtt_router_probe(fnv1a_update(h_prefix, '+'), topic, i, '+');
+            if (r) { *wildcard_out = topic + i; return r; }
+            last_level = false;
+        }
+        r = mqtt_router_probe(fnv1a_update(h_prefix, '#'), topic, i, '#');
+        if (r) { *wildcard_out = topic + i; return r; }
+    }
+    return NULL;
+}
+
+// --- PER-PANEL TOPICS ---
+// Topics of the form "ha/panel/<device id>/<leaf>", where the device id is the
+// device name lowercased with anything outside [a-z0-9_-] replaced by '_'.
+char panel_device_id[32] = "panel";
+
+void mqtt_set_device_id(const char* name) {
+    size_t n = 0;
+    for (; name && name[n] && n < sizeof(panel_device_id) - 1; n++) {
+        char c = tolower((unsigned char)name[n]);
+        panel_device_id[n] = (isalnum((unsigned char)c) || c == '-' || c == '_') ? c : '_';
+    }
+    panel_device_id[n] = '\0';
+    if (n == 0) snprintf(panel_device_id, sizeof(panel_device_id), "panel");
+}
+
+const char* panel_topic(char* buf, size_t len, const char* leaf) {
+    snprintf(buf, len, "ha/panel/%s/%s", panel_device_id, leaf);
+    return buf;
+}
+
+// --- DISPATCH (PubSubClient callback) ---
+bool mqtt_router_dispatch(char* topic, byte* payload, unsigned int len) {
+    const char* wildcard = NULL;
+    MqttRoute* r = mqtt_router_match(topic, &wildcard);
+    if (!r) return false;
+
+    char inline_buf[MQTT_INLINE_PAYLOAD];
+    char* p_buff = inline_buf;
+    if (len >= sizeof(inline_buf)) {
+        p_buff = (char*)panel_arena_alloc(&net_arena, len + 1);
+        if (p_buff == NULL) {
+            LOG_E("MQTT: not enough memory for a %u byte payload", len);
+            return false;
+        }
+    }
+    memcpy(p_buff, payload, len);
+    p_buff[len] = '\0';
+
+    r->handler(topic, wildcard, p_buff, len);
+
+    if (p_buff != inline_buf) panel_arena_free(&net_arena, p_buff);
+    return true;
+}
+
+#endif
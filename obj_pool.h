@@ -0,0 +1,106 @@
+#ifndef OBJ_POOL_H
+#define OBJ_POOL_H
+
+#include <lvgl.h>
+
+// --- LVGL OBJECT POOL ---
+// Keeps detached, pre-styled instances of one row/button type for reuse. Released
+// objects are parked, hidden, on an off-screen parent instead of being deleted,
+// so refreshing a list only re-parents and re-labels existing objects. Lists
+// that keep their rows in place use the LIST ROWS helpers below instead.
+// Event callbacks are attached once by the create function; anything per-row
+// belongs in the object's user data.
+
+#define OBJ_POOL_MAX  48   // Free objects kept per pool, extras are deleted
+
+typedef lv_obj_t* (*obj_pool_create_fn)(lv_obj_t* parent);
+
+struct ObjPool {
+    const char* name;
+    obj_pool_create_fn create;
+    lv_obj_t* free_list[OBJ_POOL_MAX];
+    uint16_t free_count;
+    uint16_t live;         // Currently handed out
+    uint16_t created;      // Objects alive in total (live + parked)
+    uint16_t high_water;   // Most objects handed out at once
+};
+
+#define OBJ_POOL_INIT(name, fn)  { name, fn, {0}, 0, 0, 0, 0 }
+
+lv_obj_t* obj_pool_parking = NULL;
+
+static lv_obj_t* obj_pool_park() {
+    if (obj_pool_parking == NULL) {
+        obj_pool_parking = lv_obj_create(NULL);   // A screen that is never loaded
+        lv_obj_add_flag(obj_pool_parking, LV_OBJ_FLAG_HIDDEN);
+    }
+    return obj_pool_parking;
+}
+
+lv_obj_t* obj_pool_acquire(ObjPool* p, lv_obj_t* parent) {
+    lv_obj_t* obj;
+    if (p->free_count > 0) {
+        obj = p->free_list[--p->free_count];
+        lv_obj_set_parent(obj, parent);
+    } else {
+        obj = p->create(parent);
+        if (obj == NULL) return NULL;
+        p->created++;
+    }
+    p->live++;
+    if (p->live > p->high_water) p->high_water = p->live;
+    return obj;
+}
+
+void obj_pool_release(ObjPool* p, lv_obj_t* obj) {
+    if (p->live > 0) p->live--;
+    if (p->free_count >= OBJ_POOL_MAX) {
+        lv_obj_delete(obj);
+        p->created--;
+        return;
+    }
+    lv_obj_set_parent(obj, obj_pool_park());
+    p->free_list[p->free_count++] = obj;
+}
+
+// Releases the children of `parent` from index `first` on. They must all come from `p`.
+void obj_pool_release_children(ObjPool* p, lv_obj_t* parent, uint32_t first = 0) {
+    if (parent == NULL) return;
+    // Walk backwards: re-parenting shifts the indices of later siblings
+    for (int32_t i = (int32_t)lv_obj_get_child_cnt(parent) - 1; i >= (int32_t)first; i--) {
+        obj_pool_release(p, lv_obj_get_child(parent, i));
+    }
+}
+
+// --- LIST ROWS ---
+// For lists refreshed in place (notifications, saved and scanned WiFi). Rows stay
+// children of their list after its `first` fixed children; a refresh walks them
+// by index and hides the ones past the new count instead of parking them, so
+// nothing is re-parented. Hidden rows still count as live.
+
+// Row `i`: the existing child, shown again if it was hidden, or a new one from
+// the pool when the list has not been this long before
+lv_obj_t* obj_pool_row(ObjPool* p, lv_obj_t* list, uint32_t i, uint32_t first = 0) {
+    if (first + i < lv_obj_get_child_cnt(list)) {
+        lv_obj_t* row = lv_obj_get_child(list, (int32_t)(first + i));
+        if (lv_obj_has_flag(row, LV_OBJ_FLAG_HIDDEN)) lv_obj_remove_flag(row, LV_OBJ_FLAG_HIDDEN);
+        return row;
+    }
+    return obj_pool_acquire(p, list);
+}
+
+// Hides rows from index `used` on, after the list's `first` fixed children
+void obj_pool_hide_rows(lv_obj_t* list, uint32_t used, uint32_t first = 0) {
+    if (list == NULL) return;
+    for (uint32_t i = first + used; i < lv_obj_get_child_cnt(list); i++) {
+        lv_obj_t* row = lv_obj_get_child(list, (int32_t)i);
+        if (!lv_obj_has_flag(row, LV_OBJ_FLAG_HIDDEN)) lv_obj_add_flag(row, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+// One line per pool, for status screens
+int obj_pool_format(char* buf, size_t len, const ObjPool* p) {
+    return snprintf(buf, len, "%s: %u/%u (max %u)\n", p->name, p->live, p->created, p->high_water);
+}
+
+#endif
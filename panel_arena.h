@@ -0,0 +1,145 @@
+#ifndef PANEL_ARENA_H
+#define PANEL_ARENA_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+
+// --- MEMORY ARENAS ---
+// Short-lived, bursty allocations get their own region so they never leave
+// holes between long-lived blocks on the system heap (LVGL has its own TLSF
+// pool, see LV_MEM_SIZE in lv_conf.h):
+//   json_arena  ArduinoJson documents for config and state messages
+//   net_arena   MQTT payload copies (router and pending config)
+// An arena is a stack: blocks are carved off the top, freeing the top block
+// gives its space back, and the arena rewinds to empty when nothing is live.
+// When an arena is full the block comes from the heap instead and is counted
+// as a fallback. Arenas are only used from the loop task.
+
+#define PANEL_JSON_ARENA_SIZE  (96 * 1024)
+#define PANEL_NET_ARENA_SIZE   (40 * 1024)    // Two MQTT_BUFFER_SIZE payloads plus headers
+#define PANEL_ARENA_ALIGN      8
+
+struct PanelArena {
+    const char* name;
+    uint8_t* base;
+    size_t size;
+    size_t top;
+    size_t high_water;
+    uint16_t live;         // Blocks currently allocated from the arena
+    uint32_t fallbacks;    // Blocks that did not fit and came from the heap
+    uint32_t resets;       // Times the arena emptied completely
+};
+
+// Precedes every block, keeps the requested size for realloc and free
+struct PanelArenaHeader {
+    uint32_t size;
+    uint32_t reserved;
+};
+
+PanelArena json_arena = { "json" };
+PanelArena net_arena = { "net" };
+
+static size_t panel_arena_round(size_t n) {
+    return (n + PANEL_ARENA_ALIGN - 1) & ~(size_t)(PANEL_ARENA_ALIGN - 1);
+}
+
+static bool panel_arena_owns(const PanelArena* a, const void* p) {
+    return a->base != NULL && (const uint8_t*)p >= a->base && (const uint8_t*)p < a->base + a->size;
+}
+
+static PanelArenaHeader* panel_arena_header(void* p) {
+    return (PanelArenaHeader*)((uint8_t*)p - sizeof(PanelArenaHeader));
+}
+
+static void* panel_arena_heap_alloc(size_t n) {
+    void* p = heap_caps_malloc(n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return p ? p : malloc(n);
+}
+
+// PSRAM first; an arena that cannot be reserved simply passes everything to the heap
+bool panel_arena_init(PanelArena* a, size_t size) {
+    a->base = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (a->base == NULL) a->base = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    a->size = a->base ? size : 0;
+    a->top = 0;
+    return a->base != NULL;
+}
+
+void* panel_arena_alloc(PanelArena* a, size_t n) {
+    size_t need = sizeof(PanelArenaHeader) + panel_arena_round(n ? n : 1);
+    if (a->base == NULL || need > a->size - a->top) {
+        a->fallbacks++;
+        return panel_arena_heap_alloc(n);
+    }
+    PanelArenaHeader* h = (PanelArenaHeader*)(a->base + a->top);
+    h->size = (uint32_t)n;
+    a->top += need;
+    if (a->top > a->high_water) a->high_water = a->top;
+    a->live++;
+    return h + 1;
+}
+
+void panel_arena_free(PanelArena* a, void* p) {
+    if (p == NULL) return;
+    if (!panel_arena_owns(a, p)) { free(p); return; }
+
+    PanelArenaHeader* h = panel_arena_header(p);
+    size_t start = (uint8_t*)h - a->base;
+    if (start + sizeof(PanelArenaHeader) + panel_arena_round(h->size ? h->size : 1) == a->top) a->top = start;
+    if (a->live > 0) a->live--;
+    if (a->live == 0) {
+        a->top = 0;
+        a->resets++;
+    }
+}
+
+void* panel_arena_realloc(PanelArena* a, void* p, size_t n) {
+    if (p == NULL) return panel_arena_alloc(a, n);
+    if (!panel_arena_owns(a, p)) return heap_caps_realloc(p, n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+
+    // The top block grows and shrinks in place, which covers ArduinoJson's string building
+    PanelArenaHeader* h = panel_arena_header(p);
+    size_t start = (uint8_t*)h - a->base;
+    size_t old_end = start + sizeof(PanelArenaHeader) + panel_arena_round(h->size ? h->size : 1);
+    size_t new_end = start + sizeof(PanelArenaHeader) + panel_arena_round(n ? n : 1);
+    if (old_end == a->top && new_end <= a->size) {
+        h->size = (uint32_t)n;
+        a->top = new_end;
+        if (a->top > a->high_water) a->high_water = a->top;
+        return p;
+    }
+
+    void* q = panel_arena_alloc(a, n);
+    if (q == NULL) return NULL;
+    memcpy(q, p, h->size < n ? h->size : n);
+    panel_arena_free(a, p);
+    return q;
+}
+
+// Fill level as a percentage of the arena, 0 when it is not reserved
+uint32_t panel_arena_hwm_pct(const PanelArena* a) {
+    return a->size ? (uint32_t)((uint64_t)a->high_water * 100 / a->size) : 0;
+}
+
+// --- ARDUINOJSON ---
+// JsonDocument doc(&json_allocator);
+class PanelJsonAllocator : public ArduinoJson::Allocator {
+public:
+    explicit PanelJsonAllocator(PanelArena* arena) : arena_(arena) {}
+    void* allocate(size_t size) override { return panel_arena_alloc(arena_, size); }
+    void deallocate(void* ptr) override { panel_arena_free(arena_, ptr); }
+    void* reallocate(void* ptr, size_t new_size) override { return panel_arena_realloc(arena_, ptr, new_size); }
+private:
+    PanelArena* arena_;
+};
+
+PanelJsonAllocator json_allocator(&json_arena);
+
+// Call from setup(), before MQTT starts
+void panel_arenas_init() {
+    panel_arena_init(&json_arena, PANEL_JSON_ARENA_SIZE);
+    panel_arena_init(&net_arena, PANEL_NET_ARENA_SIZE);
+}
+
+#endif
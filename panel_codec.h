@@ -0,0 +1,44 @@
+#ifndef PANEL_CODEC_H
+#define PANEL_CODEC_H
+
+#include <ArduinoJson.h>
+#include <PubSubClient.h>
+#include "mqtt_router.h"
+
+extern PubSubClient mqtt;
+
+// --- PAYLOAD ENCODING ---
+// Config and state topics accept JSON or MessagePack with the same schema
+// (see docs/PanelProtocol.md). The encoding is detected from the first byte, so
+// no per-topic setting is needed: JSON documents start with '{' or '[' (or
+// whitespace), MessagePack maps and arrays start with 0x80-0x9F, 0xDC-0xDF.
+// The panel announces what it understands on ha/panel/<device>/capabilities.
+
+#define PANEL_PROTOCOL_VERSION  1
+
+bool panel_payload_is_msgpack(const char* payload, size_t len) {
+    if (len == 0) return false;
+    uint8_t b = (uint8_t)payload[0];
+    return (b >= 0x80 && b <= 0x9F) || (b >= 0xDC && b <= 0xDF);
+}
+
+// True if the payload is a structured document (as opposed to a bare "on"/"off")
+bool panel_payload_is_document(const char* payload, size_t len) {
+    return len > 0 && (payload[0] == '{' || payload[0] == '[' || panel_payload_is_msgpack(payload, len));
+}
+
+DeserializationError panel_deserialize(JsonDocument& doc, const char* payload, size_t len) {
+    if (panel_payload_is_msgpack(payload, len)) return deserializeMsgPack(doc, payload, len);
+    return deserializeJson(doc, payload, len);
+}
+
+// Retained, so an HA-side helper can pick the encoding before it publishes
+void panel_codec_announce() {
+    char topic[64];
+    char payload[96];
+    snprintf(payload, sizeof(payload), "{\"protocol\":%d,\"encodings\":[\"json\",\"msgpack\"],\"max_payload\":%u}",
+             PANEL_PROTOCOL_VERSION, (unsigned)mqtt.getBufferSize());
+    mqtt.publish(panel_topic(topic, sizeof(topic), "capabilities"), payload, true);
+}
+
+#endif
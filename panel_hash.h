@@ -0,0 +1,27 @@
+#ifndef PANEL_HASH_H
+#define PANEL_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- FNV-1a (32-bit) ---
+// Used for topic routing and anywhere else we need a cheap, stable string hash.
+#define FNV1A_SEED   2166136261UL
+#define FNV1A_PRIME  16777619UL
+
+static inline uint32_t fnv1a_update(uint32_t h, uint8_t c) {
+    return (h ^ c) * FNV1A_PRIME;
+}
+
+static inline uint32_t fnv1a_n(const char* s, size_t len, uint32_t h = FNV1A_SEED) {
+    for (size_t i = 0; i < len; i++) h = fnv1a_update(h, (uint8_t)s[i]);
+    return h;
+}
+
+static inline uint32_t fnv1a(const char* s) {
+    uint32_t h = FNV1A_SEED;
+    while (*s) h = fnv1a_update(h, (uint8_t)*s++);
+    return h;
+}
+
+#endif
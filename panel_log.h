@@ -0,0 +1,320 @@
+#ifndef PANEL_LOG_H
+#define PANEL_LOG_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <stdarg.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_memory_utils.h>
+
+// --- PANEL LOG ---
+// LOG_E/W/I/D store a binary record (format string pointer, level, raw
+// arguments) in a RAM ring instead of formatting on the spot. Only %s
+// arguments are copied, into a small area inside the record, since the caller's
+// buffer may be gone by the time anyone reads the log. Formatting happens
+// later: on a low-priority task that echoes to Serial while a host is
+// connected, or when the log is requested over MQTT (diag "log").
+// Levels above PANEL_LOG_LEVEL compile to nothing.
+//
+// Writers claim a slot with an atomic increment and publish it by storing its
+// sequence number last, so any task can log without a lock. A reader that
+// finds a different sequence number skips the record.
+//
+// With PANEL_LOG_PERSIST the ring lives in RTC memory, which survives a panic
+// or watchdog reset; the next boot writes those records to /crash.log.
+
+#define PANEL_LOG_ERROR    1
+#define PANEL_LOG_WARN     2
+#define PANEL_LOG_INFO     3
+#define PANEL_LOG_DEBUG    4
+
+#ifndef PANEL_LOG_LEVEL
+#define PANEL_LOG_LEVEL    PANEL_LOG_INFO
+#endif
+#ifndef PANEL_LOG_PERSIST
+#define PANEL_LOG_PERSIST  1
+#endif
+
+#define PANEL_LOG_RECORDS    64     // Power of two
+#define PANEL_LOG_ARGS       6      // Per call; more fails to compile (see LOG_AT)
+#define PANEL_LOG_STR_BYTES  32     // Copied %s text per record
+#define PANEL_LOG_LINE_LEN   160
+#define PANEL_LOG_MAGIC      0x4C4F4731UL   // "LOG1"
+#define PANEL_LOG_CRASH_PATH "/crash.log"
+
+// Each call takes a format and at most PANEL_LOG_ARGS arguments, since a record
+// only has room for that many. Pass the fields themselves rather than
+// formatting them into a buffer first: that would undo the deferred formatting.
+// PANEL_LOG_COUNT counts the arguments after the format (up to 15) so that a
+// call with too many fails at compile time instead of losing the extras.
+#define PANEL_LOG_PICK(_f, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, n, ...)  n
+#define PANEL_LOG_COUNT(...)  PANEL_LOG_PICK(__VA_ARGS__, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 0)
+
+#define LOG_AT(lvl, ...)  do { \
+        static_assert(PANEL_LOG_COUNT(__VA_ARGS__) <= PANEL_LOG_ARGS, "too many log arguments, see PANEL_LOG_ARGS"); \
+        if (PANEL_LOG_LEVEL >= (lvl)) panel_log_write((lvl), __VA_ARGS__); \
+    } while (0)
+#define LOG_E(...)        LOG_AT(PANEL_LOG_ERROR, __VA_ARGS__)
+#define LOG_W(...)        LOG_AT(PANEL_LOG_WARN, __VA_ARGS__)
+#define LOG_I(...)        LOG_AT(PANEL_LOG_INFO, __VA_ARGS__)
+#define LOG_D(...)        LOG_AT(PANEL_LOG_DEBUG, __VA_ARGS__)
+
+struct PanelLogRecord {
+    uint32_t seq;                       // Index + 1 once complete, 0 while being written
+    uint32_t ms;
+    const char* fmt;                    // Literal in flash, doubles as the message ID
+    uint8_t level;
+    uint8_t nargs;
+    uint8_t str_used;
+    uint8_t reserved;
+    uint32_t args[PANEL_LOG_ARGS];      // Integers, pointers, floats (as float bits), string offsets
+    char strs[PANEL_LOG_STR_BYTES];
+};
+
+#if PANEL_LOG_PERSIST
+RTC_NOINIT_ATTR PanelLogRecord panel_log_ring[PANEL_LOG_RECORDS];
+RTC_NOINIT_ATTR uint32_t panel_log_magic;
+#else
+PanelLogRecord panel_log_ring[PANEL_LOG_RECORDS];
+uint32_t panel_log_magic;
+#endif
+
+uint32_t panel_log_head = 0;            // Next index to claim (atomic)
+uint32_t panel_log_echoed = 0;          // Next index the Serial task will print
+uint32_t panel_log_dropped = 0;         // Records overwritten before the Serial task got to them
+
+// --- FORMAT STRING WALKER ---
+// Finds the next conversion. Returns a pointer past it, or NULL at the end.
+// `spec` receives the full specifier (e.g. "%-8lu"), `conv` its conversion char.
+static const char* panel_log_next_spec(const char* p, char* spec, size_t spec_len, char* conv, const char** literal_end) {
+    while (*p && !(p[0] == '%' && p[1] != '%')) {
+        if (p[0] == '%') p++;   // "%%" is literal text
+        p++;
+    }
+    *literal_end = p;
+    if (*p == '\0') return NULL;
+    const char* start = p++;
+    while (*p && strchr("-+ #0123456789.*hljztL", *p)) p++;
+    *conv = *p;
+    if (*p) p++;
+    size_t n = p - start;
+    if (n >= spec_len) n = spec_len - 1;
+    memcpy(spec, start, n);
+    spec[n] = '\0';
+    return p;
+}
+
+void panel_log_write(uint8_t level, const char* fmt, ...) {
+    uint32_t idx = __atomic_fetch_add(&panel_log_head, 1, __ATOMIC_RELAXED);
+    PanelLogRecord* r = &panel_log_ring[idx & (PANEL_LOG_RECORDS - 1)];
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    r->ms = millis();
+    r->fmt = fmt;
+    r->level = level;
+    r->nargs = 0;
+    r->str_used = 0;
+
+    va_list ap;
+    va_start(ap, fmt);
+    const char* p = fmt;
+    const char* lit;
+    char spec[16];
+    char conv = 0;
+    while (r->nargs < PANEL_LOG_ARGS && (p = panel_log_next_spec(p, spec, sizeof(spec), &conv, &lit)) != NULL) {
+        uint32_t v = 0;
+        switch (conv) {
+            case 's': {
+                const char* s = va_arg(ap, const char*);
+                if (s == NULL) s = "(null)";
+                size_t room = PANEL_LOG_STR_BYTES - r->str_used;
+                size_t n = room ? strnlen(s, room - 1) : 0;
+                v = r->str_used;
+                if (room) {
+                    memcpy(r->strs + r->str_used, s, n);
+                    r->strs[r->str_used + n] = '\0';
+                    r->str_used += n + 1;
+                } else {
+                    v = PANEL_LOG_STR_BYTES;   // Out of room, printed as "..."
+                }
+                break;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+                float f = (float)va_arg(ap, double);
+                memcpy(&v, &f, sizeof(v));
+                break;
+            }
+            case 'p':
+                v = (uint32_t)(uintptr_t)va_arg(ap, void*);
+                break;
+            default:   // d i u x X c, with or without 'l' (32-bit on this target)
+                v = va_arg(ap, uint32_t);
+                break;
+        }
+        r->args[r->nargs++] = v;
+    }
+    va_end(ap);
+
+    __atomic_store_n(&r->seq, idx + 1, __ATOMIC_RELEASE);
+}
+
+// Formats one record into `out`. Returns the length written.
+static int panel_log_format(const PanelLogRecord* r, char* out, size_t len) {
+    static const char levels[] = "?EWID";
+    int n = snprintf(out, len, "[%9lu] %c ", (unsigned long)r->ms, levels[r->level <= PANEL_LOG_DEBUG ? r->level : 0]);
+    if (!esp_ptr_byte_accessible(r->fmt) && !esp_ptr_in_drom(r->fmt)) {
+        return n + snprintf(out + n, len - n, "(bad record)");
+    }
+
+    const char* p = r->fmt;
+    const char* lit;
+    char spec[16];
+    char conv = 0;
+    uint8_t arg = 0;
+    while (n < (int)len - 1) {
+        const char* next = panel_log_next_spec(p, spec, sizeof(spec), &conv, &lit);
+        // Literal text up to the conversion, with "%%" collapsed
+        for (const char* c = p; c < lit && n < (int)len - 1; c++) {
+            if (c[0] == '%' && c[1] == '%') c++;
+            out[n++] = *c;
+        }
+        out[n] = '\0';
+        if (next == NULL || arg >= r->nargs) break;
+
+        uint32_t v = r->args[arg++];
+        switch (conv) {
+            case 's':
+                n += snprintf(out + n, len - n, spec, v < PANEL_LOG_STR_BYTES ? r->strs + v : "...");
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+                float f;
+                memcpy(&f, &v, sizeof(f));
+                n += snprintf(out + n, len - n, spec, (double)f);
+                break;
+            }
+            case 'p':
+                n += snprintf(out + n, len - n, spec, (void*)(uintptr_t)v);
+                break;
+            default:
+                n += snprintf(out + n, len - n, spec, v);
+                break;
+        }
+        p = next;
+    }
+    return n < (int)len ? n : (int)len - 1;
+}
+
+// Copies record `idx` if it is still intact. Returns false if it was
+// overwritten or is still being written.
+static bool panel_log_read(uint32_t idx, PanelLogRecord* out) {
+    const PanelLogRecord* r = &panel_log_ring[idx & (PANEL_LOG_RECORDS - 1)];
+    if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != idx + 1) return false;
+    memcpy(out, r, sizeof(*out));
+    return __atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) == idx + 1;
+}
+
+// Writes up to `max_lines` of the most recent records, oldest first
+int panel_log_dump(char* buf, size_t len, int max_lines) {
+    uint32_t head = __atomic_load_n(&panel_log_head, __ATOMIC_ACQUIRE);
+    uint32_t avail = head < PANEL_LOG_RECORDS ? head : PANEL_LOG_RECORDS;
+    if (max_lines <= 0 || (uint32_t)max_lines > avail) max_lines = avail;
+    int n = 0;
+    PanelLogRecord rec;
+    for (uint32_t i = head - max_lines; i != head && n < (int)len - 1; i++) {
+        if (!panel_log_read(i, &rec)) continue;
+        n += panel_log_format(&rec, buf + n, len - n);
+        if (n < (int)len - 1) buf[n++] = '\n';
+    }
+    if (len > 0) buf[n < (int)len ? n : (int)len - 1] = '\0';
+    return n;
+}
+
+// --- SERIAL ECHO ---
+// Low priority, so formatting only uses time nothing else wants. Skips the
+// formatting entirely while no host is listening on USB.
+static void panel_log_task(void* arg) {
+    char line[PANEL_LOG_LINE_LEN];
+    PanelLogRecord rec;
+    for (;;) {
+        uint32_t head = __atomic_load_n(&panel_log_head, __ATOMIC_ACQUIRE);
+        if (head - panel_log_echoed > PANEL_LOG_RECORDS) {
+            panel_log_dropped += head - panel_log_echoed - PANEL_LOG_RECORDS;
+            panel_log_echoed = head - PANEL_LOG_RECORDS;
+        }
+        bool listening = (bool)Serial;
+        while (panel_log_echoed != head) {
+            if (!panel_log_read(panel_log_echoed, &rec)) {
+                // Still being written: try again next round. Overwritten: move on.
+                uint32_t seq = __atomic_load_n(&panel_log_ring[panel_log_echoed & (PANEL_LOG_RECORDS - 1)].seq, __ATOMIC_ACQUIRE);
+                if (seq == 0) break;
+                panel_log_dropped++;
+            } else if (listening) {
+                panel_log_format(&rec, line, sizeof(line));
+                Serial.println(line);
+            }
+            panel_log_echoed++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+}
+
+// --- CRASH LOG ---
+static bool panel_log_reset_was_crash() {
+    switch (esp_reset_reason()) {
+        case ESP_RST_PANIC:
+        case ESP_RST_INT_WDT:
+        case ESP_RST_TASK_WDT:
+        case ESP_RST_WDT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Writes the records that survived the reset, oldest first
+static void panel_log_save_crash() {
+    uint32_t newest = 0;
+    for (int i = 0; i < PANEL_LOG_RECORDS; i++) {
+        if (panel_log_ring[i].seq > newest) newest = panel_log_ring[i].seq;
+    }
+    if (newest == 0 || !LittleFS.begin(true)) return;
+
+    File f = LittleFS.open(PANEL_LOG_CRASH_PATH, "w");
+    if (!f) return;
+    f.printf("reset reason %d\n", (int)esp_reset_reason());
+    char line[PANEL_LOG_LINE_LEN];
+    uint32_t first = newest > PANEL_LOG_RECORDS ? newest - PANEL_LOG_RECORDS : 0;
+    PanelLogRecord rec;
+    for (uint32_t idx = first; idx < newest; idx++) {
+        if (!panel_log_read(idx, &rec)) continue;
+        panel_log_format(&rec, line, sizeof(line));
+        f.println(line);
+    }
+    f.close();
+}
+
+// Reads /crash.log from the last crash, if any
+int panel_log_crash_dump(char* buf, size_t len) {
+    if (!LittleFS.begin(true) || !LittleFS.exists(PANEL_LOG_CRASH_PATH)) return snprintf(buf, len, "no crash log\n");
+    File f = LittleFS.open(PANEL_LOG_CRASH_PATH, "r");
+    if (!f) return snprintf(buf, len, "no crash log\n");
+    int n = f.read((uint8_t*)buf, len - 1);
+    f.close();
+    if (n < 0) n = 0;
+    buf[n] = '\0';
+    return n;
+}
+
+// Call right after Serial.begin()
+void panel_log_init() {
+    if (PANEL_LOG_PERSIST && panel_log_magic == PANEL_LOG_MAGIC && panel_log_reset_was_crash()) {
+        panel_log_save_crash();
+    }
+    memset(panel_log_ring, 0, sizeof(panel_log_ring));
+    panel_log_magic = PANEL_LOG_MAGIC;
+    panel_log_head = 0;
+    panel_log_echoed = 0;
+    xTaskCreatePinnedToCore(panel_log_task, "log_echo", 3072, NULL, 1, NULL, 0);
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef PANEL_SCHED_H
+#define PANEL_SCHED_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+// --- LOOP SCHEDULER ---
+// Periodic work runs from LVGL timers instead of being polled on every pass
+// of loop(). loop() calls lv_timer_handler(), which runs whatever is due and
+// returns the time to the next deadline, and then sleeps that long.
+// There are three kinds of task, all plain `void fn()`:
+//   sched_every      runs every `period_ms`
+//   sched_on_screen  like sched_every, but only while `screen` is loaded
+//   sched_on_signal  runs once after each sched_signal(), e.g. when a flag is set
+// Tasks run on the loop task, in the LVGL context, so they may touch widgets.
+
+#define SCHED_MAX_IDLE_MS  50    // Upper bound for one sleep, keeps loop() alive without timers
+
+uint32_t sched_slept_ms = 0;     // Time spent in sched_idle(), read and cleared by telemetry
+
+typedef void (*sched_fn_t)();
+
+static void sched_run_cb(lv_timer_t* t) {
+    ((sched_fn_t)lv_timer_get_user_data(t))();
+}
+
+static void sched_signal_cb(lv_timer_t* t) {
+    lv_timer_pause(t);   // Before the call, so the task can signal itself again
+    ((sched_fn_t)lv_timer_get_user_data(t))();
+}
+
+lv_timer_t* sched_every(sched_fn_t fn, uint32_t period_ms) {
+    return lv_timer_create(sched_run_cb, period_ms, (void*)fn);
+}
+
+static void sched_screen_event_cb(lv_event_t* e) {
+    lv_timer_t* t = (lv_timer_t*)lv_event_get_user_data(e);
+    if (lv_event_get_code(e) == LV_EVENT_SCREEN_LOADED) {
+        lv_timer_resume(t);
+        lv_timer_ready(t);   // Fresh content as soon as the screen shows
+    } else {
+        lv_timer_pause(t);
+    }
+}
+
+lv_timer_t* sched_on_screen(lv_obj_t* screen, sched_fn_t fn, uint32_t period_ms) {
+    lv_timer_t* t = lv_timer_create(sched_run_cb, period_ms, (void*)fn);
+    if (screen == NULL || lv_screen_active() != screen) lv_timer_pause(t);
+    if (screen != NULL) {
+        lv_obj_add_event_cb(screen, sched_screen_event_cb, LV_EVENT_SCREEN_LOADED, t);
+        lv_obj_add_event_cb(screen, sched_screen_event_cb, LV_EVENT_SCREEN_UNLOADED, t);
+    }
+    return t;
+}
+
+lv_timer_t* sched_on_signal(sched_fn_t fn) {
+    lv_timer_t* t = lv_timer_create(sched_signal_cb, 0, (void*)fn);
+    lv_timer_pause(t);
+    return t;
+}
+
+// Safe to call before the task exists; the caller's flag is then picked up at creation.
+void sched_signal(lv_timer_t* t) {
+    if (t == NULL) return;
+    lv_timer_resume(t);
+    lv_timer_ready(t);
+}
+
+// Sleeps until the next timer is due, as reported by lv_timer_handler()
+void sched_idle(uint32_t next_ms) {
+    if (next_ms > SCHED_MAX_IDLE_MS) next_ms = SCHED_MAX_IDLE_MS;
+    uint32_t start = millis();
+    vTaskDelay(next_ms > portTICK_PERIOD_MS ? pdMS_TO_TICKS(next_ms) : 1);
+    sched_slept_ms += millis() - start;
+}
+
+#endif
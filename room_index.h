@@ -0,0 +1,129 @@
+#ifndef ROOM_INDEX_H
+#define ROOM_INDEX_H
+
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "entity_index.h"
+
+// --- ROOM INDEX ---
+// Rooms are numbered in order of first appearance in the config, 0 being
+// "My Home" (no filter). Lookup goes from the interned name to the id through
+// a hash table keyed by pointer, and each room keeps a bitset of the entity
+// index positions in it, so filtering the grid is a scan over a few words.
+// Tables grow on demand (PSRAM when available); the number of rooms is only
+// limited by memory.
+
+#define ROOM_INITIAL_CAP  16                       // Power of two
+#define ROOM_WORDS        ((MAX_ENTITIES + 31) / 32)
+
+const char** room_names = NULL;      // Interned, [0] = "My Home"
+uint16_t room_count = 0;
+uint16_t room_capacity = 0;
+uint16_t* room_buckets = NULL;       // Room id + 1, 0 = empty; 2x capacity
+uint32_t* room_members = NULL;       // ROOM_WORDS per room, bit = entity index position
+
+static void* room_realloc(void* p, size_t n) {
+    void* q = heap_caps_realloc(p, n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return q ? q : realloc(p, n);
+}
+
+static uint32_t room_hash(const char* name) {
+    uintptr_t v = (uintptr_t)name;
+    return (uint32_t)(v ^ (v >> 7) ^ (v >> 15)) * 2654435761u;
+}
+
+static void room_index_rehash() {
+    uint32_t mask = room_capacity * 2 - 1;
+    memset(room_buckets, 0, room_capacity * 2 * sizeof(uint16_t));
+    for (uint16_t i = 0; i < room_count; i++) {
+        uint32_t b = room_hash(room_names[i]) & mask;
+        while (room_buckets[b] != 0) b = (b + 1) & mask;
+        room_buckets[b] = i + 1;
+    }
+}
+
+static bool room_index_grow() {
+    if (room_capacity >= 0x8000) return false;
+    uint16_t cap = room_capacity ? room_capacity * 2 : ROOM_INITIAL_CAP;
+    const char** names = (const char**)room_realloc(room_names, cap * sizeof(const char*));
+    if (names == NULL) return false;
+    room_names = names;
+    uint16_t* buckets = (uint16_t*)room_realloc(room_buckets, cap * 2 * sizeof(uint16_t));
+    if (buckets == NULL) return false;
+    room_buckets = buckets;
+    uint32_t* members = (uint32_t*)room_realloc(room_members, (size_t)cap * ROOM_WORDS * sizeof(uint32_t));
+    if (members == NULL) return false;
+    room_members = members;
+    room_capacity = cap;
+    room_index_rehash();
+    return true;
+}
+
+void room_index_clear() {
+    room_count = 0;
+    if (room_buckets) memset(room_buckets, 0, room_capacity * 2 * sizeof(uint16_t));
+}
+
+// Returns the room's id, or 0 for an unknown (or NULL) name. `name` must be interned.
+uint16_t room_index_find(const char* name) {
+    if (name == NULL || room_count == 0) return 0;
+    uint32_t mask = room_capacity * 2 - 1;
+    uint32_t b = room_hash(name) & mask;
+    while (room_buckets[b] != 0) {
+        if (room_names[room_buckets[b] - 1] == name) return room_buckets[b] - 1;
+        b = (b + 1) & mask;
+    }
+    return 0;
+}
+
+// Adds an interned name if it is new. Returns its id, 0 if out of memory.
+uint16_t room_index_add(const char* name) {
+    if (name == NULL) return 0;
+    if (room_count > 0) {
+        uint16_t id = room_index_find(name);
+        if (id != 0 || room_names[0] == name) return id;
+    }
+    if (room_count >= room_capacity && !room_index_grow()) return 0;
+    uint32_t mask = room_capacity * 2 - 1;
+    uint32_t b = room_hash(name) & mask;
+    while (room_buckets[b] != 0) b = (b + 1) & mask;
+    room_names[room_count] = name;
+    room_buckets[b] = room_count + 1;
+    return room_count++;
+}
+
+// FNV-1a over the room pointers, to tell whether the chip row needs rebuilding
+uint32_t room_index_signature() {
+    if (room_count == 0) return 0;
+    return fnv1a_n((const char*)room_names, room_count * sizeof(const char*));
+}
+
+// Call after the entity index was sorted: bit positions are entity index positions.
+void room_index_rebuild_members() {
+    if (room_members == NULL) return;
+    memset(room_members, 0, (size_t)room_count * ROOM_WORDS * sizeof(uint32_t));
+    for (uint16_t i = 0; i < entity_count; i++) {
+        uint16_t r = entity_index[i].room;
+        if (r < room_count) room_members[r * ROOM_WORDS + (i >> 5)] |= 1u << (i & 31);
+    }
+}
+
+// Writes the entity positions in `room` to `out` in index order. Room 0 is everything.
+uint16_t room_index_filter(uint16_t room, uint16_t* out) {
+    uint16_t n = 0;
+    if (room == 0 || room >= room_count || room_members == NULL) {
+        for (uint16_t i = 0; i < entity_count; i++) out[n++] = i;
+        return n;
+    }
+    const uint32_t* row = &room_members[room * ROOM_WORDS];
+    for (uint16_t w = 0; w < ROOM_WORDS; w++) {
+        uint32_t bits = row[w];
+        while (bits) {
+            out[n++] = (w << 5) + __builtin_ctz(bits);
+            bits &= bits - 1;
+        }
+    }
+    return n;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SENSOR_SAMPLER_H
+#define SENSOR_SAMPLER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#include "panel_sched.h"
+
+// --- SHARED SAMPLER ---
+// Slow-changing hardware readings are taken on their own timers into one
+// snapshot, and every consumer (status icons, power screen, telemetry) reads
+// the snapshot instead of the hardware. The PMU shares the I2C bus with the
+// touch controller, so one read per period instead of one per consumer per
+// pass leaves the bus to touch. main.ino owns the PMU and fills in
+// sampler_pmu_cb; WiFi is read here.
+
+#define SAMPLE_PMU_MS  5000    // Battery, charger and VBUS
+#define SAMPLE_NET_MS  2000    // RSSI, SSID and IP
+
+struct PanelPowerSample {
+    bool present;        // Battery connected
+    bool charging;
+    bool usb;            // VBUS above 4 V
+    int percent;         // -1 without a battery
+    uint16_t mv;         // Battery voltage, 0 without a battery
+    uint16_t vbus_mv;
+};
+
+struct PanelNetSample {
+    bool connected;
+    int rssi;
+    char ssid[33];
+    char ip[16];
+};
+
+struct PanelSample {
+    PanelPowerSample power;
+    PanelNetSample net;
+    uint32_t power_ms;   // millis() of the last successful PMU read, 0 = never
+    uint32_t net_ms;
+};
+
+PanelSample panel_sample = {};
+
+// Filled in by main.ino, which owns the PMU
+bool (*sampler_pmu_cb)(PanelPowerSample* out) = NULL;
+
+lv_timer_t* sampler_pmu_timer = NULL;
+lv_timer_t* sampler_net_timer = NULL;
+
+void sensor_sampler_read_power() {
+    PanelPowerSample s = {};
+    if (sampler_pmu_cb == NULL || !sampler_pmu_cb(&s)) return;
+    panel_sample.power = s;
+    panel_sample.power_ms = millis();
+}
+
+void sensor_sampler_read_net() {
+    PanelNetSample* n = &panel_sample.net;
+    wifi_ap_record_t ap;
+    // Straight from the driver: WiFi.SSID() would build a String every sample
+    n->connected = (WiFi.status() == WL_CONNECTED) && esp_wifi_sta_get_ap_info(&ap) == ESP_OK;
+    if (n->connected) {
+        IPAddress ip = WiFi.localIP();
+        n->rssi = ap.rssi;
+        strlcpy(n->ssid, (const char*)ap.ssid, sizeof(n->ssid));
+        snprintf(n->ip, sizeof(n->ip), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    } else {
+        n->rssi = 0;
+        n->ssid[0] = '\0';
+        n->ip[0] = '\0';
+    }
+    panel_sample.net_ms = millis();
+}
+
+// Call from setup_sched(), once the PMU is up: takes the first samples right away
+void sensor_sampler_init() {
+    sensor_sampler_read_power();
+    sensor_sampler_read_net();
+    sampler_pmu_timer = sched_every(sensor_sampler_read_power, SAMPLE_PMU_MS);
+    sampler_net_timer = sched_every(sensor_sampler_read_net, SAMPLE_NET_MS);
+}
+
+// Resample on the next timer pass, after something is known to have changed
+void sensor_sampler_refresh() {
+    if (sampler_pmu_timer) lv_timer_ready(sampler_pmu_timer);
+    if (sampler_net_timer) lv_timer_ready(sampler_net_timer);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef STRING_INTERN_H
+#define STRING_INTERN_H
+
+#include <Arduino.h>
+#include "panel_hash.h"
+#include "panel_log.h"
+
+// --- STRING INTERNING ---
+// Entity IDs, room names etc. are stored once in append-only blocks and handed
+// out as stable `const char*`. Two interned strings are equal iff their pointers are.
+// Blocks live in PSRAM when available and are never freed, so a pointer stays
+// valid across config rebuilds. Only strings from the config are interned
+// (state reports for unknown IDs are dropped, see update_device_state), so the
+// table grows with config edits, not with MQTT traffic. The slot table doubles
+// when it is 3/4 full; only running out of memory makes interning fail.
+
+#define INTERN_BLOCK_SIZE  4096
+#define INTERN_BUCKETS     2048   // Initial slot count, power of two
+
+struct InternBlock {
+    InternBlock* next;
+    size_t used;
+    char data[INTERN_BLOCK_SIZE];
+};
+
+struct InternSlot {
+    uint32_t hash;
+    const char* str;
+};
+
+InternBlock* intern_blocks = NULL;
+InternSlot* intern_slots = NULL;
+uint32_t intern_capacity = 0;   // Slots, power of two
+uint32_t intern_count = 0;
+uint32_t intern_bytes = 0;
+
+static void* intern_alloc(size_t size) {
+    void* p = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p == NULL) p = calloc(1, size);
+    return p;
+}
+
+static const char* intern_store(const char* s, size_t len) {
+    if (len + 1 > INTERN_BLOCK_SIZE) return NULL;
+    if (intern_blocks == NULL || intern_blocks->used + len + 1 > INTERN_BLOCK_SIZE) {
+        InternBlock* b = (InternBlock*)intern_alloc(sizeof(InternBlock));
+        if (b == NULL) return NULL;
+        b->next = intern_blocks;
+        intern_blocks = b;
+    }
+    char* dst = intern_blocks->data + intern_blocks->used;
+    memcpy(dst, s, len);
+    dst[len] = '\0';
+    intern_blocks->used += len + 1;
+    intern_bytes += len + 1;
+    return dst;
+}
+
+// Rehashes into a table twice the size; the strings themselves do not move
+static bool intern_grow() {
+    uint32_t cap = intern_capacity ? intern_capacity * 2 : INTERN_BUCKETS;
+    InternSlot* slots = (InternSlot*)intern_alloc(sizeof(InternSlot) * cap);
+    if (slots == NULL) return false;
+    for (uint32_t i = 0; i < intern_capacity; i++) {
+        if (intern_slots[i].str == NULL) continue;
+        uint32_t b = intern_slots[i].hash & (cap - 1);
+        while (slots[b].str != NULL) b = (b + 1) & (cap - 1);
+        slots[b] = intern_slots[i];
+    }
+    free(intern_slots);
+    intern_slots = slots;
+    intern_capacity = cap;
+    return true;
+}
+
+// Returns the canonical copy of `s`, creating it on first use. NULL only when out of memory.
+const char* intern_string(const char* s, uint32_t* hash_out = NULL) {
+    if (s == NULL) s = "";
+    // Keep the table at most 3/4 full so probes stay short
+    if (intern_count >= (intern_capacity * 3) / 4 && !intern_grow()) {
+        LOG_E("INTERN: Out of memory growing to %lu slots", (unsigned long)intern_capacity * 2);
+        if (intern_slots == NULL || intern_count >= intern_capacity - 1) return NULL;
+    }
+
+    size_t len = strlen(s);
+    uint32_t h = fnv1a_n(s, len);
+    if (hash_out) *hash_out = h;
+
+    uint32_t b = h & (intern_capacity - 1);
+    while (intern_slots[b].str != NULL) {
+        if (intern_slots[b].hash == h && strcmp(intern_slots[b].str, s) == 0) return intern_slots[b].str;
+        b = (b + 1) & (intern_capacity - 1);
+    }
+
+    const char* stored = intern_store(s, len);
+    if (stored == NULL) {
+        LOG_E("INTERN: Out of memory storing %u bytes", (unsigned)len + 1);
+        return NULL;
+    }
+    intern_slots[b].hash = h;
+    intern_slots[b].str = stored;
+    intern_count++;
+    return stored;
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <WiFi.h>
+#include <Preferences.h>
+#include <lvgl.h>
+#include "mqtt_link.h"
+#include "panel_log.h"
+#include "panel_arena.h"
+#include "ui_bind.h"
+#include "sensor_sampler.h"
+
+extern Preferences prefs;
+
+// --- PANEL TELEMETRY ---
+// Publishes the panel's own health to ha/panel/<device>/telemetry: heap and
+// PSRAM (free, minimum, largest block), the LVGL pool and memory arenas, skipped UI updates, frame render time and loop period
+// percentiles over the last interval, RSSI, MQTT reconnects, uptime and
+// battery. The payload is built in a static buffer, nothing is allocated.
+// The interval is stored in NVS ("telem_int", seconds, 0 = off) and can be
+// changed by publishing the number of seconds to .../telemetry/set.
+
+#define TELEM_DEFAULT_S    60
+#define TELEM_MIN_S        10
+#define TELEM_HIST_MS      64     // 1 ms buckets, the last one collects everything slower
+
+// Per-interval distribution of a duration in milliseconds
+struct TelemHist {
+    uint16_t bucket[TELEM_HIST_MS];
+    uint32_t count;
+    uint32_t max_ms;
+};
+
+uint16_t telem_interval_s = TELEM_DEFAULT_S;
+uint32_t telem_last_ms = 0;
+uint32_t telem_window_ms = 0;     // Start of the interval the histograms and idle time cover
+uint32_t telem_loop_last_us = 0;
+uint32_t telem_render_start_us = 0;
+int telem_route_set = -1;
+TelemHist telem_frame;
+TelemHist telem_loop;
+char telem_topic[64];
+char telem_payload[1024];
+
+static void telem_hist_add(TelemHist* h, uint32_t ms) {
+    if (ms > h->max_ms) h->max_ms = ms;
+    if (ms >= TELEM_HIST_MS) ms = TELEM_HIST_MS - 1;
+    if (h->bucket[ms] < UINT16_MAX) h->bucket[ms]++;
+    h->count++;
+}
+
+static uint32_t telem_hist_pct(const TelemHist* h, uint8_t pct) {
+    if (h->count == 0) return 0;
+    uint32_t want = (h->count * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (uint32_t ms = 0; ms < TELEM_HIST_MS; ms++) {
+        seen += h->bucket[ms];
+        if (seen >= want) return (ms == TELEM_HIST_MS - 1) ? h->max_ms : ms;
+    }
+    return h->max_ms;
+}
+
+// --- FRAME TIME ---
+static void telem_on_render(lv_event_t* e) {
+    if (lv_event_get_code(e) == LV_EVENT_RENDER_START) {
+        telem_render_start_us = micros();
+    } else if (telem_render_start_us != 0) {
+        telem_hist_add(&telem_frame, (micros() - telem_render_start_us) / 1000);
+        telem_render_start_us = 0;
+    }
+}
+
+// Bracket the work in one loop() pass; the idle sleep after it is not counted
+void telemetry_loop_mark() {
+    telem_loop_last_us = micros();
+}
+
+void telemetry_loop_done() {
+    if (telem_loop_last_us != 0) telem_hist_add(&telem_loop, (micros() - telem_loop_last_us) / 1000);
+}
+
+// --- INTERVAL ---
+void telemetry_set_interval(uint16_t seconds, bool persist) {
+    if (seconds != 0 && seconds < TELEM_MIN_S) seconds = TELEM_MIN_S;
+    telem_interval_s = seconds;
+    if (persist) {
+        prefs.begin("sys_config", false);
+        prefs.putUShort("telem_int", seconds);
+        prefs.end();
+    }
+}
+
+static void telem_on_set_msg(const char* topic, const char* wildcard, char* payload, unsigned int len) {
+    char* end = NULL;
+    long s = strtol(payload, &end, 10);
+    if (end == payload || s < 0 || s > 86400) return;
+    telemetry_set_interval((uint16_t)(s > UINT16_MAX ? UINT16_MAX : s), true);
+    LOG_I("Telemetry: interval set to %u s", telem_interval_s);
+}
+
+void telemetry_setup_routes() {
+    telem_route_set = mqtt_router_on(panel_topic(telem_topic, sizeof(telem_topic), "telemetry/set"), telem_on_set_msg);
+}
+
+void telemetry_topics_changed() {
+    mqtt_link_set_route_filter(telem_route_set, panel_topic(telem_topic, sizeof(telem_topic), "telemetry/set"));
+}
+
+// Reads the interval from NVS and hooks frame timing into the display
+void telemetry_init(lv_display_t* disp) {
+    prefs.begin("sys_config", true);
+    telem_interval_s = prefs.getUShort("telem_int", TELEM_DEFAULT_S);
+    prefs.end();
+    if (disp) {
+        lv_display_add_event_cb(disp, telem_on_render, LV_EVENT_RENDER_START, NULL);
+        lv_display_add_event_cb(disp, telem_on_render, LV_EVENT_RENDER_READY, NULL);
+    }
+}
+
+// --- PUBLISH ---
+static bool telemetry_publish() {
+    // Battery and RSSI come from the shared sampler, publishing adds no bus traffic
+    const PanelPowerSample& bat = panel_sample.power;
+    bool has_bat = panel_sample.power_ms != 0;
+    uint32_t window = millis() - telem_window_ms;
+    uint32_t idle_pct = window ? (uint32_t)((uint64_t)sched_slept_ms * 100 / window) : 0;
+
+    int n = snprintf(telem_payload, sizeof(telem_payload),
+        "{\"uptime\":%lu,"
+        "\"heap\":{\"free\":%u,\"min\":%u,\"largest\":%u},"
+        "\"psram\":{\"free\":%u,\"min\":%u,\"largest\":%u},"
+        "\"frame_ms\":{\"n\":%lu,\"p50\":%lu,\"p95\":%lu,\"p99\":%lu,\"max\":%lu},"
+        "\"loop_ms\":{\"n\":%lu,\"p50\":%lu,\"p95\":%lu,\"max\":%lu,\"idle_pct\":%lu},"
+        "\"rssi\":%d,\"mqtt_connects\":%lu,\"mqtt_failures\":%lu",
+        (unsigned long)(esp_timer_get_time() / 1000000),
+        (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL), (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+        (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL),
+        (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM), (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM),
+        (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM),
+        (unsigned long)telem_frame.count, (unsigned long)telem_hist_pct(&telem_frame, 50),
+        (unsigned long)telem_hist_pct(&telem_frame, 95), (unsigned long)telem_hist_pct(&telem_frame, 99),
+        (unsigned long)telem_frame.max_ms,
+        (unsigned long)telem_loop.count, (unsigned long)telem_hist_pct(&telem_loop, 50),
+        (unsigned long)telem_hist_pct(&telem_loop, 95), (unsigned long)telem_loop.max_ms, (unsigned long)idle_pct,
+        panel_sample.net.rssi, (unsigned long)mqtt_link_connects, (unsigned long)mqtt_link_failed_total);
+
+    if (n > 0 && n < (int)sizeof(telem_payload)) {
+        lv_mem_monitor_t mon;
+        lv_mem_monitor(&mon);
+        n += snprintf(telem_payload + n, sizeof(telem_payload) - n,
+            ",\"lvgl_mem\":{\"free\":%u,\"max_used\":%u,\"frag\":%u}"
+            ",\"arenas\":{\"json\":{\"hwm\":%u,\"fallbacks\":%lu},\"net\":{\"hwm\":%u,\"fallbacks\":%lu}}"
+            ",\"ui_updates\":{\"applied\":%lu,\"suppressed\":%lu}",
+            (unsigned)mon.free_size, (unsigned)mon.max_used, (unsigned)mon.frag_pct,
+            (unsigned)json_arena.high_water, (unsigned long)json_arena.fallbacks,
+            (unsigned)net_arena.high_water, (unsigned long)net_arena.fallbacks,
+            (unsigned long)ui_bind_applied, (unsigned long)ui_bind_suppressed);
+    }
+    if (n > 0 && n < (int)sizeof(telem_payload)) {
+        if (has_bat) {
+            n += snprintf(telem_payload + n, sizeof(telem_payload) - n,
+                ",\"battery\":{\"present\":%s,\"percent\":%d,\"mv\":%u,\"charging\":%s,\"usb\":%s}}",
+                bat.present ? "true" : "false", bat.percent, bat.mv,
+                bat.charging ? "true" : "false", bat.usb ? "true" : "false");
+        } else {
+            n += snprintf(telem_payload + n, sizeof(telem_payload) - n, "}");
+        }
+    }
+    if (n <= 0 || n >= (int)sizeof(telem_payload)) return false;
+
+    panel_topic(telem_topic, sizeof(telem_topic), "telemetry");
+    return mqtt.publish(telem_topic, (const uint8_t*)telem_payload, n, false);
+}
+
+// Called from the scheduler's slow network task
+void telemetry_process() {
+    if (telem_interval_s == 0 || !mqtt_link_ready()) return;
+    uint32_t now = millis();
+    if (telem_last_ms != 0 && now - telem_last_ms < (uint32_t)telem_interval_s * 1000) return;
+    telem_last_ms = now;
+
+    if (telemetry_publish()) {
+        // Percentiles cover one interval
+        memset(&telem_frame, 0, sizeof(telem_frame));
+        memset(&telem_loop, 0, sizeof(telem_loop));
+        sched_slept_ms = 0;
+        telem_window_ms = now;
+    }
+}
+
+#endif
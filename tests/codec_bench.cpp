@@ -0,0 +1,92 @@
+// Host benchmark for panel_codec.h: size and parse time of an n-button config
+// as JSON and as MessagePack, parsed through panel_deserialize() the way a
+// config from HA is. ArduinoJson is header-only; point -I at its src/ folder
+// (the library manager puts it in ~/Arduino/libraries/ArduinoJson/src):
+//
+//   g++ -std=c++17 -O2 -I. -Itests/stubs -I$HOME/Arduino/libraries/ArduinoJson/src tests/codec_bench.cpp -o /tmp/codec_bench && /tmp/codec_bench
+//
+// Documents use ArduinoJson's default heap allocator rather than the json
+// arena, and times are host times: the diag command "codec [n]" gives the
+// panel's own numbers. Sizes are the same on both.
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <chrono>
+
+// --- STUBS ---
+#define MQTT_ROUTER_H
+
+PubSubClient mqtt;
+const char* panel_topic(char* buf, size_t len, const char* leaf) {
+    snprintf(buf, len, "ha/panel/bench/%s", leaf);
+    return buf;
+}
+
+#include "panel_codec.h"
+
+// --- CONFIG ---
+// Same shape as diag_codec() in diag.h
+static void build_config(JsonDocument& src, int buttons) {
+    static const char* const rooms[] = { "Living Room", "Kitchen", "Bedroom", "Office", "Garden", "Hall" };
+    static const char* const icons[] = { "light", "power", "fan", "blinds", "lock", "tv" };
+    JsonArray arr = src["buttons"].to<JsonArray>();
+    char text[40];
+    for (int i = 0; i < buttons; i++) {
+        JsonObject b = arr.add<JsonObject>();
+        snprintf(text, sizeof(text), "light.bench_%d", i);
+        b["entity"] = (char*)text;
+        snprintf(text, sizeof(text), "%s %d", rooms[i % 6], i);
+        b["name"] = (char*)text;
+        b["icon"] = icons[i % 6];
+        b["room"] = rooms[i % 6];
+        b["state"] = (i & 1) ? "ON" : "OFF";
+    }
+}
+
+// --- RUNNER ---
+#define RUNS  2000
+
+struct Result { size_t bytes; double us_per_parse; bool ok; };
+
+static Result run(const char* body, size_t len, int buttons) {
+    Result r = { len, 0, true };
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < RUNS; i++) {
+        JsonDocument doc;
+        if (panel_deserialize(doc, body, len) || doc["buttons"].size() != (size_t)buttons) r.ok = false;
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    r.us_per_parse = (double)ns / RUNS / 1000.0;
+    return r;
+}
+
+int main() {
+    static const int sizes[] = { 12, 48, 120, 200 };   // 48 is the diag default, 200 its maximum
+    int failures = 0;
+    printf("%-8s  %10s %10s  %10s %10s  %6s\n", "buttons", "json B", "us/parse", "msgpack B", "us/parse", "size");
+    for (int buttons : sizes) {
+        JsonDocument src;
+        build_config(src, buttons);
+
+        size_t json_len = measureJson(src);
+        size_t pack_len = measureMsgPack(src);
+        char* json = (char*)malloc(json_len + 1);
+        char* pack = (char*)malloc(pack_len);
+        serializeJson(src, json, json_len + 1);
+        serializeMsgPack(src, pack, pack_len);
+
+        // The encoding must be detected from the first byte, as on the panel
+        if (panel_payload_is_msgpack(json, json_len) || !panel_payload_is_msgpack(pack, pack_len)) failures++;
+
+        Result j = run(json, json_len, buttons);
+        Result m = run(pack, pack_len, buttons);
+        printf("%-8d  %10zu %10.1f  %10zu %10.1f  %5zu%%\n", buttons,
+               j.bytes, j.us_per_parse, m.bytes, m.us_per_parse, m.bytes * 100 / j.bytes);
+        if (!j.ok || !m.ok || m.bytes >= j.bytes) failures++;
+
+        free(json);
+        free(pack);
+    }
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,185 @@
+// Host test for the outgoing command queue (command_queue.h) against the real
+// state store and intern table. MQTT link, router and log are stubbed below.
+//
+//   g++ -std=c++17 -I. -Itests/stubs tests/command_queue_test.cpp -o /tmp/command_queue_test && /tmp/command_queue_test
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+// --- STUBS ---
+#define MQTT_LINK_H
+#define MQTT_ROUTER_H
+#define PANEL_LOG_H
+#define LOG_E(...) do {} while (0)
+#define LOG_W(...) do {} while (0)
+#define LOG_I(...) do {} while (0)
+#define LOG_D(...) do {} while (0)
+
+typedef void (*mqtt_route_cb_t)(const char* topic, const char* wildcard, char* payload, unsigned int len);
+
+PubSubClient mqtt;
+bool host_online = true;
+bool mqtt_link_ready() { return host_online; }
+int mqtt_router_on(const char*, mqtt_route_cb_t) { return 0; }
+void mqtt_link_set_route_filter(int, const char*) {}
+const char* panel_topic(char* buf, size_t len, const char* leaf) {
+    snprintf(buf, len, "ha/panel/test/%s", leaf);
+    return buf;
+}
+
+#include "command_queue.h"
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// What update_device_state() in ui_logic.h does with a report from HA
+static void report(const char* id, bool on) {
+    const EntityState* st = entity_state_find(id);
+    if (st == NULL) return;
+    if (cmd_queue_on_report(id, on)) on = st->on;
+    entity_state_set(id, on);
+}
+
+// Runs the queue the way the scheduler does, every 10 ms for `ms`
+static void run_for(uint32_t ms) {
+    for (uint32_t t = 0; t < ms; t += 10) {
+        host_millis += 10;
+        cmd_queue_process();
+    }
+}
+
+static void reset() {
+    memset(cmd_queue, 0, sizeof(cmd_queue));
+    cmd_stats_sent = cmd_stats_coalesced = cmd_stats_rolled_back = 0;
+    memset(&lat_total, 0, sizeof(lat_total));
+    memset(&lat_roundtrip, 0, sizeof(lat_roundtrip));
+    memset(lat_entities, 0, sizeof(lat_entities));
+}
+
+static void test_echo_confirms_toggle() {
+    reset();
+    const char* id = entity_state_get("light.kitchen")->id;   // Configured
+    report(id, false);
+
+    cmd_queue_toggle(id, false, true);
+    run_for(CMD_COALESCE_MS + 20);
+    CHECK(cmd_stats_sent == 1);
+    CHECK(strstr(mqtt.last_payload, "turn_on") != NULL);
+
+    // HA echoes the value the optimistic write already put in the store
+    run_for(200);
+    report("light.kitchen", true);
+    CHECK(!cmd_queue_is_pending(id));
+
+    run_for(CMD_CONFIRM_MS + 1000);
+    CHECK(cmd_stats_rolled_back == 0);
+    CHECK(entity_state_find(id)->on);
+}
+
+static void test_missing_echo_rolls_back() {
+    reset();
+    const char* id = entity_state_get("switch.fan")->id;
+    report(id, false);
+
+    cmd_queue_toggle(id, false, true);
+    run_for(CMD_COALESCE_MS + 20);
+    CHECK(cmd_queue_is_pending(id));
+
+    run_for(CMD_CONFIRM_MS + 100);
+    CHECK(cmd_stats_rolled_back == 1);
+    CHECK(!cmd_queue_is_pending(id));
+    CHECK(!entity_state_find(id)->on);
+}
+
+static void test_contrary_report_sets_rollback_target() {
+    reset();
+    const char* id = entity_state_get("light.hall")->id;
+    report(id, false);
+
+    cmd_queue_toggle(id, false, true);
+    report(id, true);              // Changed elsewhere before our command went out
+    run_for(CMD_COALESCE_MS + 20);
+    run_for(CMD_CONFIRM_MS + 100);
+    CHECK(cmd_stats_rolled_back == 1);
+    CHECK(entity_state_find(id)->on);
+}
+
+static void test_report_before_send_keeps_target() {
+    reset();
+    const char* id = entity_state_get("light.desk")->id;
+    report(id, false);
+
+    cmd_queue_toggle(id, false, true);
+    report(id, false);             // HA repeats the old state before our command goes out
+    CHECK(entity_state_find(id)->on);
+    CHECK(cmd_queue_is_pending(id));
+
+    run_for(CMD_COALESCE_MS + 20);
+    report(id, false);             // Late report of the old state after the send
+    CHECK(entity_state_find(id)->on);
+
+    report(id, true);              // The echo
+    CHECK(!cmd_queue_is_pending(id));
+    CHECK(entity_state_find(id)->on);
+    CHECK(cmd_stats_rolled_back == 0);
+}
+
+// user-036: the confirm is timed on the state-report path
+static void test_confirm_records_latency() {
+    reset();
+    memset(&lat_panel, 0, sizeof(lat_panel));
+    const char* id = entity_state_get("cover.blinds")->id;
+    report(id, false);
+
+    uint32_t tap = host_millis;
+    cmd_queue_toggle(id, false, true);
+    run_for(CMD_COALESCE_MS + 20);
+    PanelCommand* c = cmd_queue_find(id);
+    CHECK(c != NULL && c->sent_ms != 0);
+    uint32_t sent = c ? c->sent_ms : 0;
+    run_for(300);
+    report(id, true);
+
+    CHECK(lat_panel.count == 1);
+    CHECK(lat_roundtrip.count == 1);
+    CHECK(lat_total.count == 1);
+    CHECK(lat_roundtrip.max_ms == host_millis - sent);
+    CHECK(lat_total.max_ms == host_millis - tap);
+    CHECK(lat_entities[0].id == id && lat_entities[0].count == 1);
+
+    char buf[512];
+    latency_format(buf, sizeof(buf));
+    CHECK(strstr(buf, "Tap>HA") != NULL && strstr(buf, "(n=1)") != NULL);
+    CHECK(strstr(buf, "Slowest: cover.blinds") != NULL);
+}
+
+// The scheduler only runs the queue after a wake and until it is empty again
+static int wakes = 0;
+static void count_wake() { wakes++; }
+
+static void test_toggle_wakes_queue_until_empty() {
+    reset();
+    cmd_queue_wake_cb = count_wake;
+    const char* id = entity_state_get("light.porch")->id;
+    report(id, false);
+    CHECK(cmd_queue_empty());
+
+    cmd_queue_toggle(id, false, true);
+    CHECK(wakes == 1);
+    CHECK(!cmd_queue_empty());
+    run_for(CMD_COALESCE_MS + 20);
+    report(id, true);
+    CHECK(cmd_queue_empty());
+    cmd_queue_wake_cb = NULL;
+}
+
+int main() {
+    test_echo_confirms_toggle();
+    test_missing_echo_rolls_back();
+    test_contrary_report_sets_rollback_target();
+    test_report_before_send_keeps_target();
+    test_confirm_records_latency();
+    test_toggle_wakes_queue_until_empty();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
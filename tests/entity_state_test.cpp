@@ -0,0 +1,93 @@
+// Host test for the entity state store (entity_state.h) and the intern table
+// (string_intern.h): pruning, slot reuse and growth past the initial table.
+//
+//   g++ -std=c++17 -I. -Itests/stubs tests/entity_state_test.cpp -o /tmp/entity_state_test && /tmp/entity_state_test
+
+#include <Arduino.h>
+
+// --- STUBS ---
+#define PANEL_LOG_H
+static int log_errors = 0;
+#define LOG_E(...) do { log_errors++; } while (0)
+#define LOG_W(...) do {} while (0)
+#define LOG_I(...) do {} while (0)
+#define LOG_D(...) do {} while (0)
+
+#include "entity_state.h"
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static const char* keep_prefix = "";
+static bool keep_by_prefix(const EntityState* s) {
+    return strncmp(s->id, keep_prefix, strlen(keep_prefix)) == 0;
+}
+
+static void test_prune_keeps_pointers_and_reuses_slots() {
+    char id[32];
+    for (int i = 0; i < 100; i++) {
+        snprintf(id, sizeof(id), "%s.%d", (i % 2) ? "light" : "switch", i);
+        CHECK(entity_state_set(id, true));
+    }
+    EntityState* kept = entity_state_find("light.1");
+    CHECK(kept != NULL);
+
+    keep_prefix = "light.";
+    entity_state_prune(keep_by_prefix);
+    CHECK(entity_state_find("switch.0") == NULL);
+    CHECK(entity_state_find("light.1") == kept);   // Survivors never move
+    CHECK(kept->on);
+    for (int i = 1; i < 100; i += 2) {
+        snprintf(id, sizeof(id), "light.%d", i);
+        CHECK(entity_state_find(id) != NULL);
+    }
+
+    // New entries go into the freed slots before the store grows
+    uint16_t slots = entity_state_count;
+    for (int i = 0; i < 50; i++) {
+        snprintf(id, sizeof(id), "fan.%d", i);
+        CHECK(entity_state_get(id) != NULL);
+    }
+    CHECK(entity_state_count == slots);
+    CHECK(entity_state_free == 0);
+
+    keep_prefix = "";
+    entity_state_prune(keep_by_prefix);
+}
+
+static void test_store_is_bounded_by_config_not_history() {
+    // Many configs with different entities: pruning keeps the store from filling
+    char id[32];
+    for (int config = 0; config < 20; config++) {
+        for (int i = 0; i < STATE_MAX / 2; i++) {
+            snprintf(id, sizeof(id), "light.c%d_%d", config, i);
+            CHECK(entity_state_get(id) != NULL);
+        }
+        snprintf(id, sizeof(id), "light.c%d_", config);
+        keep_prefix = id;
+        entity_state_prune(keep_by_prefix);
+        CHECK(entity_state_count - entity_state_free == STATE_MAX / 2);
+    }
+    CHECK(log_errors == 0);
+}
+
+static void test_intern_grows_past_initial_table() {
+    char s[32];
+    const char* first = intern_string("first");
+    for (int i = 0; i < INTERN_BUCKETS * 2; i++) {
+        snprintf(s, sizeof(s), "str.%d", i);
+        CHECK(intern_string(s) != NULL);
+    }
+    CHECK(intern_capacity > INTERN_BUCKETS);
+    CHECK(intern_string("first") == first);   // Same pointer after rehashing
+    CHECK(intern_string("str.7") == intern_string("str.7"));
+    CHECK(log_errors == 0);
+}
+
+int main() {
+    test_prune_keeps_pointers_and_reuses_slots();
+    test_store_is_bounded_by_config_not_history();
+    test_intern_grows_past_initial_table();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// Host microbenchmark for fixed_string.h: the string work handle_clock_update()
+// does once a second (including update_status_icons()), as it was written with
+// Arduino String and as it is now with FixedString and const char*.
+//
+//   g++ -std=c++17 -O2 -I. -Itests/stubs tests/fixed_string_bench.cpp -o /tmp/fixed_string_bench && /tmp/fixed_string_bench
+//
+// The String below models arduino-esp32's WString where it matters here:
+// strings up to STRING_SSO_SIZE - 1 bytes live inside the object, longer ones
+// are allocated, and every concat that outgrows the buffer reallocates to the
+// exact new length. Heap calls are counted; times are host times and only
+// meaningful relative to each other.
+
+#include <Arduino.h>
+#include <chrono>
+#include <utility>
+#include "fixed_string.h"
+
+#define LV_SYMBOL_BELL           "\xEF\x83\xB3"
+#define LV_SYMBOL_BATTERY_2      "\xEF\x89\x82"
+#define STRING_SSO_SIZE          11      // sizeof(_ptr) + 4 - 1 on a 32-bit target
+
+static uint32_t heap_calls = 0;
+
+// --- STRING MODEL ---
+class String {
+public:
+    String() { sso_[0] = '\0'; }
+    String(const char* s) { sso_[0] = '\0'; concat(s, strlen(s)); }
+    String(int v) { char b[12]; snprintf(b, sizeof(b), "%d", v); sso_[0] = '\0'; concat(b, strlen(b)); }
+    String(float v, int decimals) { char b[33]; snprintf(b, sizeof(b), "%.*f", decimals, v); sso_[0] = '\0'; concat(b, strlen(b)); }
+    String(const String& o) { sso_[0] = '\0'; concat(o.c_str(), o.len_); }
+    String(String&& o) : heap_(o.heap_), cap_(o.cap_), len_(o.len_) {
+        memcpy(sso_, o.sso_, sizeof(sso_));
+        o.heap_ = NULL; o.len_ = 0; o.sso_[0] = '\0';
+    }
+    ~String() { free(heap_); }
+    String& operator=(const String& o) { if (this != &o) { len_ = 0; buf()[0] = '\0'; concat(o.c_str(), o.len_); } return *this; }
+
+    String& concat(const char* s, size_t n) {
+        size_t need = len_ + n;
+        if (heap_ == NULL && need < STRING_SSO_SIZE) {
+            memcpy(sso_ + len_, s, n);
+        } else {
+            if (heap_ == NULL || need + 1 > cap_) {
+                char* p = (char*)realloc(heap_, need + 1);
+                heap_calls++;
+                if (heap_ == NULL) memcpy(p, sso_, len_);
+                heap_ = p;
+                cap_ = need + 1;
+            }
+            memcpy(heap_ + len_, s, n);
+        }
+        len_ = need;
+        buf()[len_] = '\0';
+        return *this;
+    }
+
+    const char* c_str() const { return heap_ ? heap_ : sso_; }
+
+private:
+    char* buf() { return heap_ ? heap_ : sso_; }
+    char sso_[STRING_SSO_SIZE];
+    char* heap_ = NULL;
+    size_t cap_ = 0;
+    size_t len_ = 0;
+};
+
+// String + x copies the left side once, later + append to that temporary
+String operator+(const String& a, const char* b) { String r(a); return r.concat(b, strlen(b)); }
+String operator+(String&& a, const char* b) { a.concat(b, strlen(b)); return std::move(a); }
+String operator+(String&& a, const String& b) { a.concat(b.c_str(), strlen(b.c_str())); return std::move(a); }
+
+// --- THE PER-SECOND PATH ---
+static const char* label_sink;     // Stands in for lv_label_set_text()
+static void set_text(const char* s) { label_sink = s; }
+
+static const char* weather_names[] = { "Clear Sky", "Partly Cloudy", "Moderate Drizzle", "Thunderstorm" };
+
+static String weather_string(int code) { return String(weather_names[code]); }
+
+static void tick_string(float temp, int weather, int alerts) {
+    set_text((String(temp, 0) + "°").c_str());
+    set_text(weather_string(weather).c_str());
+    String t = String(temp, 0) + "°";                  // Sleep screen
+    set_text(t.c_str());
+    if (alerts > 0) {
+        String n = String(LV_SYMBOL_BELL) + "  " + String(alerts) + " Alerts";
+        set_text(n.c_str());
+    }
+    String batText = "";
+    batText = String(LV_SYMBOL_BATTERY_2);
+    set_text(batText.c_str());
+}
+
+static void tick_fixed(float temp, int weather, int alerts) {
+    FixedString<16> t;
+    t.appendf("%.0f°", temp);
+    set_text(t.c_str());
+    set_text(weather_names[weather]);
+    set_text(t.c_str());
+    if (alerts > 0) {
+        FixedString<24> n;
+        n.appendf(LV_SYMBOL_BELL "  %d Alerts", alerts);
+        set_text(n.c_str());
+    }
+    const char* batText = LV_SYMBOL_BATTERY_2;
+    set_text(batText);
+}
+
+// --- RUNNER ---
+#define TICKS  100000
+
+struct Result { double heap_per_tick; double ns_per_tick; };
+
+static Result run(void (*tick)(float, int, int), int weather, int alerts) {
+    heap_calls = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < TICKS; i++) tick(18.0f + (i % 10), weather, alerts);
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return { (double)heap_calls / TICKS, (double)ns / TICKS };
+}
+
+int main() {
+    static const struct { int weather; int alerts; } cases[] = { {0, 0}, {1, 3}, {2, 12}, {3, 0} };
+    int failures = 0;
+    printf("%-18s %6s  %14s %10s  %14s %10s\n", "weather", "alerts", "String heap/s", "ns/tick", "Fixed heap/s", "ns/tick");
+    for (const auto& c : cases) {
+        Result s = run(tick_string, c.weather, c.alerts);
+        Result f = run(tick_fixed, c.weather, c.alerts);
+        printf("%-18s %6d  %14.1f %10.0f  %14.1f %10.0f\n", weather_names[c.weather], c.alerts,
+               s.heap_per_tick, s.ns_per_tick, f.heap_per_tick, f.ns_per_tick);
+        if (f.heap_per_tick != 0) failures++;
+    }
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
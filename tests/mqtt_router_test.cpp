@@ -0,0 +1,136 @@
+// Host test for topic routing (mqtt_router.h) with the panel's real route set.
+// Arena and log are stubbed below.
+//
+//   g++ -std=c++17 -I. -Itests/stubs tests/mqtt_router_test.cpp -o /tmp/mqtt_router_test && /tmp/mqtt_router_test
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+// --- STUBS ---
+#define PANEL_ARENA_H
+#define PANEL_LOG_H
+#define LOG_E(...) do {} while (0)
+#define LOG_W(...) do {} while (0)
+#define LOG_I(...) do {} while (0)
+#define LOG_D(...) do {} while (0)
+
+struct PanelArena { const char* name; };
+PanelArena net_arena = { "net" };
+void* panel_arena_alloc(PanelArena*, size_t n) { return malloc(n); }
+void panel_arena_free(PanelArena*, void* p) { free(p); }
+
+PubSubClient mqtt;
+
+#include "mqtt_router.h"
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// --- HANDLERS ---
+static int batch_calls, entity_calls, other_calls;
+static char last_wildcard[64];
+static char last_payload[512];
+
+static void on_batch(const char*, const char* wildcard, char* payload, unsigned int) {
+    batch_calls++;
+    CHECK(wildcard == NULL);
+    snprintf(last_payload, sizeof(last_payload), "%s", payload);
+}
+
+static void on_entity(const char*, const char* wildcard, char* payload, unsigned int) {
+    entity_calls++;
+    snprintf(last_wildcard, sizeof(last_wildcard), "%s", wildcard ? wildcard : "");
+    snprintf(last_payload, sizeof(last_payload), "%s", payload);
+}
+
+static void on_other(const char*, const char*, char*, unsigned int) {
+    other_calls++;
+}
+
+// Same routes as setup_mqtt_routes() and the modules it calls
+static void setup_routes() {
+    char t[64];
+    mqtt_router_on("ha/panel/config/set", on_other);
+    mqtt_router_on("ha/panel/states", on_batch);
+    mqtt_router_on("ha/panel/state/+", on_entity);
+    mqtt_router_on("ha/panel/notify", on_other);
+    mqtt_router_on(panel_topic(t, sizeof(t), "ping"), on_other);
+    mqtt_router_on(panel_topic(t, sizeof(t), "telemetry/set"), on_other);
+    mqtt_router_on(panel_topic(t, sizeof(t), "diag"), on_other);
+}
+
+static void dispatch(const char* topic, const char* payload) {
+    char t[128];
+    snprintf(t, sizeof(t), "%s", topic);
+    batch_calls = entity_calls = other_calls = 0;
+    last_wildcard[0] = '\0';
+    mqtt_router_dispatch(t, (byte*)payload, (unsigned)strlen(payload));
+}
+
+// True if a broker could deliver one message to both filters. The panel only
+// uses exact filters and a single trailing '+' or '#'.
+static bool filters_overlap(const char* a, const char* b) {
+    if (strcmp(a, b) == 0) return true;
+    for (int pass = 0; pass < 2; pass++) {
+        const char* w = pass ? a : b;
+        const char* e = pass ? b : a;
+        size_t n = strlen(w);
+        if (n < 2 || w[n - 2] != '/') continue;
+        if (strncmp(w, e, n - 1) != 0) continue;
+        if (w[n - 1] == '#') return true;
+        if (w[n - 1] == '+' && strchr(e + n - 1, '/') == NULL) return true;
+    }
+    return false;
+}
+
+static void test_batch_and_entity_topics_are_separate() {
+    dispatch("ha/panel/states", "{\"states\":[]}");
+    CHECK(batch_calls == 1 && entity_calls == 0);
+
+    dispatch("ha/panel/state/light.kitchen", "on");
+    CHECK(batch_calls == 0 && entity_calls == 1);
+    CHECK(strcmp(last_wildcard, "light.kitchen") == 0);
+
+    // The old batch topic is an ordinary per-entity topic now
+    dispatch("ha/panel/state/update", "off");
+    CHECK(batch_calls == 0 && entity_calls == 1);
+    CHECK(strcmp(last_wildcard, "update") == 0);
+}
+
+static void test_no_subscription_overlaps() {
+    for (int i = 0; i < mqtt_route_count; i++) {
+        for (int j = i + 1; j < mqtt_route_count; j++) {
+            bool overlap = filters_overlap(mqtt_routes[i].filter, mqtt_routes[j].filter);
+            if (overlap) printf("overlap: %s / %s\n", mqtt_routes[i].filter, mqtt_routes[j].filter);
+            CHECK(!overlap);
+        }
+    }
+}
+
+static void test_wildcard_depth_and_misses() {
+    dispatch("ha/panel/state/a/b", "on");            // '+' is one level only
+    CHECK(entity_calls == 0 && batch_calls == 0);
+    dispatch("ha/panel/state", "on");
+    CHECK(entity_calls == 0);
+    dispatch("ha/panel/config/set", "{}");
+    CHECK(other_calls == 1 && entity_calls == 0);
+}
+
+static void test_large_payload_is_copied_whole() {
+    char big[400];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    dispatch("ha/panel/states", big);                 // Above MQTT_INLINE_PAYLOAD, goes through the arena
+    CHECK(batch_calls == 1);
+    CHECK(strlen(last_payload) == sizeof(big) - 1);
+}
+
+int main() {
+    setup_routes();
+    test_batch_and_entity_topics_are_separate();
+    test_no_subscription_overlaps();
+    test_wildcard_depth_and_misses();
+    test_large_payload_is_copied_whole();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// Soak test for the config and state path that does not touch LVGL: intern
+// table, state store, entity and room indexes and the command queue. Applies
+// SOAK_CYCLES configs, each followed by a burst of state reports, stray topics
+// and taps, and checks that heap use stops growing once the tables have sized
+// themselves. Configs go through layout_index_apply(), the same code
+// apply_layout() runs before it builds widgets. Widgets, object pools and the
+// json arena need the panel; there, diag "snap" / "leaks" around the same kind
+// of run does the same check.
+//
+//   g++ -std=c++17 -I. -Itests/stubs tests/soak_test.cpp -o /tmp/soak_test && /tmp/soak_test
+
+#include <Arduino.h>
+#include <PubSubClient.h>
+#include <malloc.h>
+
+// --- STUBS ---
+#define MQTT_LINK_H
+#define MQTT_ROUTER_H
+#define PANEL_LOG_H
+static int log_errors = 0;
+#define LOG_E(...) do { log_errors++; } while (0)
+#define LOG_W(...) do {} while (0)
+#define LOG_I(...) do {} while (0)
+#define LOG_D(...) do {} while (0)
+
+typedef void (*mqtt_route_cb_t)(const char* topic, const char* wildcard, char* payload, unsigned int len);
+
+PubSubClient mqtt;
+bool mqtt_link_ready() { return true; }
+int mqtt_router_on(const char*, mqtt_route_cb_t) { return 0; }
+void mqtt_link_set_route_filter(int, const char*) {}
+const char* panel_topic(char* buf, size_t len, const char* leaf) {
+    snprintf(buf, len, "ha/panel/test/%s", leaf);
+    return buf;
+}
+
+#include "layout_index.h"
+#include "command_queue.h"
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#define SOAK_CYCLES   10000
+#define SOAK_WARMUP   100      // Cycles before the baseline; tables grow to their working size
+#define SOAK_CONFIGS  7
+
+// --- WHAT ui_logic.h DOES ---
+static void update_device_state(const char* entity_id, bool is_on) {
+    const EntityState* st = entity_state_find(entity_id);
+    if (st == NULL) return;
+    if (cmd_queue_on_report(entity_id, is_on)) is_on = st->on;
+    entity_state_set(entity_id, is_on);
+}
+
+// --- CONFIGS ---
+// Overlapping configs of different sizes: entities move between rooms, rooms
+// are renamed, and config 0 is empty. Names repeat across cycles the way they
+// do when HA re-publishes; interned strings are kept for the process lifetime.
+static char texts[SOAK_CONFIGS][MAX_ENTITIES][4][40];
+static LayoutItem configs[SOAK_CONFIGS][MAX_ENTITIES];
+static uint16_t config_size[SOAK_CONFIGS];
+
+static void build_configs() {
+    static const char* const icons[] = { "light", "power", "fan", "blinds" };
+    for (int c = 0; c < SOAK_CONFIGS; c++) {
+        config_size[c] = (uint16_t)(c == 0 ? 0 : 40 * c + 13);
+        for (int i = 0; i < config_size[c]; i++) {
+            int e = i + c * 17;   // Shifts the window, so each config drops some entities and adds others
+            char (*t)[40] = texts[c][i];
+            snprintf(t[0], 40, "light.soak_%d", e);
+            snprintf(t[1], 40, "Lamp %d", e);
+            snprintf(t[2], 40, "Room %d", (e + c) % 9);
+            snprintf(t[3], 40, "%s", icons[e % 4]);
+            configs[c][i] = { t[0], t[1], t[3], t[2], (e & 1) != 0 };
+        }
+    }
+}
+
+static uint16_t state_peak = 0;    // Most state slots in use at once
+
+static size_t heap_in_use() {
+    return mallinfo2().uordblks;
+}
+
+static void cycle(uint32_t n) {
+    int c = n % SOAK_CONFIGS;
+    layout_index_apply(configs[c], config_size[c]);   // The index part of apply_layout()
+
+    char id[40];
+    for (int i = 0; i < 50; i++) {
+        snprintf(id, sizeof(id), "light.soak_%u", (unsigned)((n * 31 + i * 7) % 400));
+        update_device_state(id, ((n + i) & 1) != 0);
+    }
+    // Topics for entities no config ever had must not be stored
+    snprintf(id, sizeof(id), "sensor.stray_%u", (unsigned)n);
+    update_device_state(id, true);
+
+    // Taps, half of which HA confirms; the rest roll back on their own
+    if (config_size[c] > 0) {
+        const char* tap = entity_index[n % entity_count].id;
+        cmd_queue_toggle(tap, entity_index[n % entity_count].state->on, !entity_index[n % entity_count].state->on);
+    }
+    for (int step = 0; step < 30; step++) {
+        host_millis += 10;
+        cmd_queue_process();
+    }
+    if ((n & 1) && config_size[c] > 0) {
+        const EntityEntry* e = &entity_index[n % entity_count];
+        if (cmd_queue_is_pending(e->id)) update_device_state(e->id, e->state->on);
+    }
+    host_millis += 1000;
+    cmd_queue_process();
+    if (entity_state_count > state_peak) state_peak = entity_state_count;
+}
+
+int main() {
+    build_configs();
+
+    for (uint32_t n = 0; n < SOAK_WARMUP; n++) cycle(n);
+    size_t baseline = heap_in_use();
+    uint16_t warm_peak = state_peak;
+
+    for (uint32_t n = SOAK_WARMUP; n < SOAK_CYCLES; n++) cycle(n);
+    size_t end = heap_in_use();
+
+    printf("heap in use after %d cycles: %zu bytes, after %d: %zu bytes (%+ld)\n",
+           SOAK_WARMUP, baseline, SOAK_CYCLES, end, (long)end - (long)baseline);
+    printf("state store: peak %u slots; intern table: %u slots\n", state_peak, (unsigned)intern_capacity);
+    CHECK(end == baseline);
+    CHECK(state_peak == warm_peak);   // Sized by the largest config, not by history
+    CHECK(entity_state_find("sensor.stray_5000") == NULL);
+    CHECK(log_errors == 0);
+
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
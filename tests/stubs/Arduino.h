@@ -0,0 +1,29 @@
+#ifndef HOST_ARDUINO_STUB_H
+#define HOST_ARDUINO_STUB_H
+
+// Just enough of the Arduino core for the panel's plain-C++ headers to build
+// on a host. Time is driven by the test through host_millis.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+typedef uint8_t byte;
+
+#define MALLOC_CAP_SPIRAM    (1 << 10)
+#define MALLOC_CAP_INTERNAL  (1 << 11)
+#define MALLOC_CAP_8BIT      (1 << 2)
+#define MALLOC_CAP_DEFAULT   (1 << 12)
+
+inline uint32_t host_millis = 0;
+inline uint32_t millis() { return host_millis; }
+inline uint32_t micros() { return host_millis * 1000; }
+
+inline void* heap_caps_malloc(size_t n, uint32_t) { return malloc(n); }
+inline void* heap_caps_calloc(size_t c, size_t n, uint32_t) { return calloc(c, n); }
+inline void* heap_caps_realloc(void* p, size_t n, uint32_t) { return realloc(p, n); }
+
+#endif
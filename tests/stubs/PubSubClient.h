@@ -0,0 +1,40 @@
+#ifndef HOST_PUBSUBCLIENT_STUB_H
+#define HOST_PUBSUBCLIENT_STUB_H
+
+// Records what the panel publishes instead of talking to a broker
+#include <stdint.h>
+#include <string.h>
+
+class PubSubClient {
+public:
+    int published = 0;
+    int subscribed = 0;
+    char last_topic[128] = "";
+    char last_payload[256] = "";
+    uint16_t buffer_size = 16384;   // As set by mqtt_link.h
+
+    uint16_t getBufferSize() { return buffer_size; }
+
+    bool publish(const char* topic, const char* payload) {
+        return publish(topic, (const uint8_t*)payload, (unsigned)strlen(payload), false);
+    }
+    bool publish(const char* topic, const char* payload, bool retained) {
+        return publish(topic, (const uint8_t*)payload, (unsigned)strlen(payload), retained);
+    }
+    bool publish(const char* topic, const uint8_t* payload, unsigned len, bool retained) {
+        (void)retained;
+        strncpy(last_topic, topic, sizeof(last_topic) - 1);
+        size_t n = len < sizeof(last_payload) - 1 ? len : sizeof(last_payload) - 1;
+        memcpy(last_payload, payload, n);
+        last_payload[n] = '\0';
+        published++;
+        return true;
+    }
+    bool subscribe(const char* topic, uint8_t qos = 0) {
+        (void)topic; (void)qos;
+        subscribed++;
+        return true;
+    }
+};
+
+#endif
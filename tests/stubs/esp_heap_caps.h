@@ -0,0 +1,6 @@
+#ifndef HOST_ESP_HEAP_CAPS_STUB_H
+#define HOST_ESP_HEAP_CAPS_STUB_H
+
+#include <Arduino.h>   // heap_caps_* live in the Arduino stub
+
+#endif
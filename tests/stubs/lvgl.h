@@ -0,0 +1,7 @@
+#ifndef HOST_LVGL_STUB_H
+#define HOST_LVGL_STUB_H
+
+// The index headers only hold widget pointers; they never call into LVGL.
+typedef struct _lv_obj_t lv_obj_t;
+
+#endif
@@ -0,0 +1,68 @@
+// Host test for the cooperative UI builder (ui_builder.h): FIFO order holds
+// when more jobs are pushed than the queue has room for.
+//
+//   g++ -std=c++17 -I. -Itests/stubs tests/ui_builder_test.cpp -o /tmp/ui_builder_test && /tmp/ui_builder_test
+
+#include <Arduino.h>
+
+// --- STUBS ---
+#define PANEL_LOG_H
+#define LOG_E(...) do {} while (0)
+#define LOG_W(...) do {} while (0)
+#define LOG_I(...) do {} while (0)
+#define LOG_D(...) do {} while (0)
+
+#include "ui_builder.h"
+
+static int failures = 0;
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static int ran[256];
+static int ran_count = 0;
+
+static void record_job(void* arg) {
+    ran[ran_count++] = (int)(intptr_t)arg;
+}
+
+// Like a grid job that queues its follow-up
+static void chain_job(void* arg) {
+    int n = (int)(intptr_t)arg;
+    record_job(arg);
+    if (n % 10 == 0) ui_builder_push(record_job, (void*)(intptr_t)(1000 + n));
+}
+
+static void test_overflow_keeps_fifo() {
+    ran_count = 0;
+    for (int i = 0; i < UI_BUILD_QUEUE * 3; i++) ui_builder_push(record_job, (void*)(intptr_t)i);
+    ui_builder_finish();
+    CHECK(ran_count == UI_BUILD_QUEUE * 3);
+    for (int i = 0; i < ran_count; i++) CHECK(ran[i] == i);
+}
+
+static void test_overflow_with_jobs_that_push() {
+    ran_count = 0;
+    for (int i = 0; i < 100; i++) ui_builder_push(chain_job, (void*)(intptr_t)i);
+    ui_builder_finish();
+    CHECK(ran_count == 110);
+    // Every follow-up runs after the job that queued it
+    for (int i = 0; i < ran_count; i++) {
+        if (ran[i] < 1000) continue;
+        bool parent_before = false;
+        for (int j = 0; j < i; j++) if (ran[j] == ran[i] - 1000) parent_before = true;
+        CHECK(parent_before);
+    }
+    // The plain jobs keep their order
+    int last = -1;
+    for (int i = 0; i < ran_count; i++) {
+        if (ran[i] >= 1000) continue;
+        CHECK(ran[i] > last);
+        last = ran[i];
+    }
+}
+
+int main() {
+    test_overflow_keeps_fifo();
+    test_overflow_with_jobs_that_push();
+    printf("%s\n", failures ? "FAILED" : "OK");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,64 @@
+#ifndef UI_BIND_H
+#define UI_BIND_H
+
+#include <Arduino.h>
+#include <lvgl.h>
+#include <stdarg.h>
+
+// --- BOUND PROPERTIES ---
+// Setters for the labels and icons refreshed on a timer (clock, weather,
+// status icons). Every LVGL setter invalidates the widget, even when the value
+// is the same, so these compare with the value the widget already holds and
+// only call LVGL on a real change. The widget is the cache: a label written
+// elsewhere (weather fetch, location screen) is never shadowed by a stale copy.
+// All setters accept NULL objects and return true when they changed something.
+
+uint32_t ui_bind_applied = 0;       // Setter calls that reached LVGL, since boot
+uint32_t ui_bind_suppressed = 0;    // Setter calls skipped because nothing changed
+
+static bool ui_bind_count(bool changed) {
+    if (changed) ui_bind_applied++;
+    else ui_bind_suppressed++;
+    return changed;
+}
+
+bool ui_bind_text(lv_obj_t* label, const char* text) {
+    if (label == NULL || text == NULL) return false;
+    const char* cur = lv_label_get_text(label);
+    if (cur != NULL && strcmp(cur, text) == 0) return ui_bind_count(false);
+    lv_label_set_text(label, text);
+    return ui_bind_count(true);
+}
+
+bool ui_bind_text_fmt(lv_obj_t* label, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+bool ui_bind_text_fmt(lv_obj_t* label, const char* fmt, ...) {
+    if (label == NULL) return false;
+    char buf[64];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return ui_bind_text(label, buf);
+}
+
+// Local text color of the main part, as set by lv_obj_set_style_text_color(obj, c, 0)
+bool ui_bind_text_color(lv_obj_t* obj, lv_color_t color) {
+    if (obj == NULL) return false;
+    lv_style_value_t v;
+    if (lv_obj_get_local_style_prop(obj, LV_STYLE_TEXT_COLOR, &v, 0) == LV_STYLE_RES_FOUND &&
+        lv_color_eq(v.color, color)) {
+        return ui_bind_count(false);
+    }
+    lv_obj_set_style_text_color(obj, color, 0);
+    return ui_bind_count(true);
+}
+
+bool ui_bind_hidden(lv_obj_t* obj, bool hidden) {
+    if (obj == NULL) return false;
+    if (lv_obj_has_flag(obj, LV_OBJ_FLAG_HIDDEN) == hidden) return ui_bind_count(false);
+    if (hidden) lv_obj_add_flag(obj, LV_OBJ_FLAG_HIDDEN);
+    else lv_obj_remove_flag(obj, LV_OBJ_FLAG_HIDDEN);
+    return ui_bind_count(true);
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef UI_BUILDER_H
+#define UI_BUILDER_H
+
+#include <Arduino.h>
+#include "panel_log.h"
+
+// --- COOPERATIVE UI BUILDER ---
+// Widget construction is queued as small jobs and run from loop() under a
+// per-frame time budget, so touch input and animations keep running while a
+// large layout materializes. Jobs run in FIFO order; code that needs a screen
+// to be complete (e.g. before loading it) calls ui_builder_finish().
+
+#define UI_BUILD_QUEUE      32    // Power of two
+#define UI_BUILD_BUDGET_US  8000  // Leaves room for rendering inside a 33ms frame
+
+typedef void (*ui_build_fn_t)(void* arg);
+
+struct UiBuildJob {
+    ui_build_fn_t fn;
+    void* arg;
+};
+
+UiBuildJob ui_build_queue[UI_BUILD_QUEUE];
+uint16_t ui_build_head = 0;   // Next job to run
+uint16_t ui_build_tail = 0;   // Next free slot
+
+// Stats for the current (or last finished) build
+uint32_t ui_build_started_ms = 0;
+uint32_t ui_build_busy_us = 0;        // Time spent inside jobs
+uint32_t ui_build_max_slice_us = 0;   // Longest single ui_builder_run() call
+uint16_t ui_build_jobs = 0;
+uint32_t ui_build_last_total_ms = 0;  // Wall time of the last completed build
+
+bool ui_builder_busy() {
+    return ui_build_head != ui_build_tail;
+}
+
+static void ui_builder_report() {
+    ui_build_last_total_ms = millis() - ui_build_started_ms;
+    LOG_I("UI Builder: %u jobs, %lu ms total (%lu ms busy), longest slice %lu us",
+          ui_build_jobs, (unsigned long)ui_build_last_total_ms,
+          (unsigned long)(ui_build_busy_us / 1000), (unsigned long)ui_build_max_slice_us);
+}
+
+static void ui_builder_run_one() {
+    UiBuildJob job = ui_build_queue[ui_build_head];
+    ui_build_head = (ui_build_head + 1) & (UI_BUILD_QUEUE - 1);
+    job.fn(job.arg);
+    ui_build_jobs++;
+}
+
+static bool ui_builder_full() {
+    return ((ui_build_tail + 1) & (UI_BUILD_QUEUE - 1)) == ui_build_head;
+}
+
+// Queues a job. When the queue is full the oldest jobs run first to make room,
+// so jobs still run in the order they were pushed.
+void ui_builder_push(ui_build_fn_t fn, void* arg = NULL) {
+    if (!ui_builder_busy()) {
+        ui_build_started_ms = millis();
+        ui_build_busy_us = 0;
+        ui_build_max_slice_us = 0;
+        ui_build_jobs = 0;
+    }
+    if (ui_builder_full()) {
+        uint32_t start = micros();
+        while (ui_builder_full()) ui_builder_run_one();   // A job may push again; loop until a slot is free
+        ui_build_busy_us += micros() - start;
+    }
+    ui_build_queue[ui_build_tail].fn = fn;
+    ui_build_queue[ui_build_tail].arg = arg;
+    ui_build_tail = (ui_build_tail + 1) & (UI_BUILD_QUEUE - 1);
+}
+
+// Called once per loop(). Always runs at least one job so progress is guaranteed.
+void ui_builder_run(uint32_t budget_us = UI_BUILD_BUDGET_US) {
+    if (!ui_builder_busy()) return;
+    uint32_t start = micros();
+    do {
+        ui_builder_run_one();
+    } while (ui_builder_busy() && (micros() - start) < budget_us);
+
+    uint32_t slice = micros() - start;
+    ui_build_busy_us += slice;
+    if (slice > ui_build_max_slice_us) ui_build_max_slice_us = slice;
+    if (!ui_builder_busy()) ui_builder_report();
+}
+
+// Drains the queue synchronously.
+void ui_builder_finish() {
+    if (!ui_builder_busy()) return;
+    uint32_t start = micros();
+    while (ui_builder_busy()) ui_builder_run_one();
+
+    uint32_t slice = micros() - start;
+    ui_build_busy_us += slice;
+    if (slice > ui_build_max_slice_us) ui_build_max_slice_us = slice;
+    ui_builder_report();
+}
+
+#endif
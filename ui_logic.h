@@ -4,23 +4,29 @@
 #include "ui.h"
 #include "ui_comp.h"
 #include <ArduinoJson.h>
+#include "entity_index.h"
+#include "room_index.h"
+#include "ui_builder.h"
+#include "ui_styles.h"
+#include "obj_pool.h"
+#include "command_queue.h"
+#include "layout_index.h"
+#include "layout_cache.h"
+#include "panel_codec.h"
+#include "panel_arena.h"
+#include "heap_debug.h"
 
 extern PubSubClient mqtt;
 extern void show_notification_popup(const char* text, int index);
 
-// --- VISUAL CONSTANTS ---
-#define COLOR_ACTIVE_YELLOW  0xFEC106  
-#define COLOR_INACTIVE_GREY  0xD6D6D6  
-#define COLOR_BG_BLACK       0x000000  
-#define COLOR_TEXT_WHITE     0xFFFFFF
-#define COLOR_BLUE_ACTIVE    0x28A0FB
+const char* current_room_filter = "My Home";   // Interned room name, survives rebuilds
+uint16_t current_room_idx = 0;   // Room id, 0 = "My Home" (no filter)
 
-// Dimensions 
-#define SW_WIDTH   205 
-#define SW_HEIGHT  70
-
-String current_room_filter = "My Home"; 
-bool is_first_ui_update = true;
+// --- STATE PARSING ---
+bool state_payload_is_on(const char* st) {
+    if (st == NULL) return false;
+    return (strcasecmp(st, "on") == 0) || (strcasecmp(st, "open") == 0);
+}
 
 // --- ICON MAPPING ---
 const void* get_icon_by_name(const char* icon_name) {
@@ -40,93 +46,253 @@ const void* get_icon_by_name(const char* icon_name) {
 }
 
 // --- VISUAL UPDATES ---
+// The icon circle and image carry CHECKED variants of their shared styles;
+// state does not propagate to children, so it is set on all three.
 void update_manual_switch_visuals(lv_obj_t* btn, bool is_on) {
     if (lv_obj_get_child_cnt(btn) < 1) return;
     lv_obj_t* icon_cont = lv_obj_get_child(btn, 0);
     lv_obj_t* icon_img = (lv_obj_get_child_cnt(icon_cont) > 0) ? lv_obj_get_child(icon_cont, 0) : NULL;
 
-    if (is_on) {
-        lv_obj_set_style_bg_color(icon_cont, lv_color_hex(COLOR_ACTIVE_YELLOW), LV_PART_MAIN);
-        if(icon_img) {
-            lv_obj_set_style_img_recolor(icon_img, lv_color_hex(COLOR_ACTIVE_YELLOW), LV_PART_MAIN);
-            lv_obj_set_style_img_recolor_opa(icon_img, 255, LV_PART_MAIN);
-        }
-    } else {
-        lv_obj_set_style_bg_color(icon_cont, lv_color_hex(COLOR_BG_BLACK), LV_PART_MAIN);
-        if(icon_img) {
-            lv_obj_set_style_img_recolor(icon_img, lv_color_hex(COLOR_INACTIVE_GREY), LV_PART_MAIN); 
-            lv_obj_set_style_img_recolor_opa(icon_img, 255, LV_PART_MAIN);
-        }
-    }
+    lv_obj_set_state(btn, LV_STATE_CHECKED, is_on);
+    lv_obj_set_state(icon_cont, LV_STATE_CHECKED, is_on);
+    if (icon_img) lv_obj_set_state(icon_img, LV_STATE_CHECKED, is_on);
 }
 
 // --- CLICK HANDLER ---
+// Grid buttons are recycled, so the entity comes from the button's own user data.
+// The new state is shown immediately; command_queue.h sends it and rolls it back
+// if HA never confirms.
 void on_manual_switch_toggle(lv_event_t* e) {
+    if (lv_indev_get_gesture_dir(lv_indev_active()) != LV_DIR_NONE) return; // Page swipe, not a tap
     lv_obj_t* btn = (lv_obj_t*)lv_event_get_target(e);
-    const char* entity_id = (const char*)lv_event_get_user_data(e);
-    
-    bool was_on = lv_obj_has_state(btn, LV_STATE_CHECKED);
-    if(was_on) lv_obj_clear_state(btn, LV_STATE_CHECKED);
-    else lv_obj_add_state(btn, LV_STATE_CHECKED);
-    
-    update_manual_switch_visuals(btn, !was_on);
-
-    if (entity_id) {
-        JsonDocument* doc = new JsonDocument();
-        (*doc)["entity_id"] = entity_id;
-        (*doc)["action"] = !was_on ? "turn_on" : "turn_off";
-        if (strstr(entity_id, "cover.")) (*doc)["action"] = !was_on ? "open_cover" : "close_cover";
-        if (strstr(entity_id, "scene.")) (*doc)["action"] = "turn_on"; 
-        
-        char buffer[128];
-        serializeJson(*doc, buffer);
-        if (mqtt.connected()) mqtt.publish("ha/panel/command", buffer);
-        delete doc;
+    const char* entity_id = (const char*)lv_obj_get_user_data(btn);
+    if (entity_id == NULL) return;
+
+    EntityEntry* ent = entity_index_find(entity_id);
+    bool was_on = ent ? ent->state->on : lv_obj_has_state(btn, LV_STATE_CHECKED);
+    cmd_queue_toggle(ent ? ent->id : intern_string(entity_id), was_on, !was_on);
+}
+
+// --- VIRTUAL GRID ---
+// Only one page of buttons exists. GRID_SLOTS widgets are created once, laid out
+// from a precomputed grid and rebound to entities when the page or room filter
+// changes, so memory and frame time do not depend on the number of entities.
+#define GRID_COLS   2
+#define GRID_ROWS   3
+#define GRID_SLOTS  (GRID_COLS * GRID_ROWS)
+#define GRID_GAP    10
+
+struct GridSlot {
+    lv_obj_t* btn;
+    lv_obj_t* img;
+    lv_obj_t* lbl_name;
+    lv_obj_t* lbl_room;
+    const char* name;   // Currently shown (interned), used to skip no-op updates
+    const char* icon;
+    const char* room;
+};
+
+GridSlot grid_slots[GRID_SLOTS];
+lv_point_t grid_pos[GRID_SLOTS];
+uint8_t grid_dirty = 0;                // Bit per slot: state changed, restyle at the next frame
+uint32_t grid_state_updates = 0;       // State changes that hit a visible button
+uint32_t grid_state_coalesced = 0;     // ...of which were absorbed by one already waiting for the frame
+uint16_t grid_view[MAX_ENTITIES];   // Entity indices passing the room filter, in config order
+uint16_t grid_view_count = 0;
+uint16_t grid_page = 0;
+lv_obj_t* grid_page_label = NULL;
+
+uint16_t grid_page_count() {
+    return (grid_view_count == 0) ? 1 : (grid_view_count + GRID_SLOTS - 1) / GRID_SLOTS;
+}
+
+static void grid_bind_slot(GridSlot* s, EntityEntry* ent) {
+    if (ent == NULL) {
+        lv_obj_add_flag(s->btn, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_set_user_data(s->btn, NULL);
+        return;
     }
+    const char* room = (ent->room < room_count) ? room_names[ent->room] : "Home";
+
+    // Strings are interned and never freed, so labels can point at them directly
+    if (s->name != ent->name) { lv_label_set_text_static(s->lbl_name, ent->name); s->name = ent->name; }
+    if (s->room != room)      { lv_label_set_text_static(s->lbl_room, room); s->room = room; }
+    if (s->icon != ent->icon) { lv_img_set_src(s->img, get_icon_by_name(ent->icon)); s->icon = ent->icon; }
+
+    lv_obj_set_user_data(s->btn, (void*)ent->id);
+    ent->btn = s->btn;
+
+    grid_dirty &= ~(1u << (s - grid_slots));
+    update_manual_switch_visuals(s->btn, ent->state->on);
+    lv_obj_set_state(s->btn, LV_STATE_USER_1, cmd_queue_is_pending(ent->id));
+    lv_obj_clear_flag(s->btn, LV_OBJ_FLAG_HIDDEN);
 }
 
-void apply_switch_filter() {
-    if (!ui_haswC) return;
-    uint32_t count = lv_obj_get_child_cnt(ui_haswC);
-    for(uint32_t i=0; i<count; i++) {
-        lv_obj_t* btn = lv_obj_get_child(ui_haswC, i);
-        if (lv_obj_get_child_cnt(btn) < 3) continue; 
-        
-        lv_obj_t* room_lbl = lv_obj_get_child(btn, 2); 
-        if(!room_lbl) continue;
-        
-        String room = String(lv_label_get_text(room_lbl));
-        
-        if (current_room_filter == "My Home" || room == current_room_filter) {
-            lv_obj_clear_flag(btn, LV_OBJ_FLAG_HIDDEN);
+void grid_render() {
+    uint16_t pages = grid_page_count();
+    if (grid_page >= pages) grid_page = pages - 1;
+
+    for (uint16_t i = 0; i < entity_count; i++) entity_index[i].btn = NULL;
+    for (int i = 0; i < GRID_SLOTS; i++) {
+        if (!grid_slots[i].btn) continue;   // Still queued on the UI builder
+        uint32_t v = (uint32_t)grid_page * GRID_SLOTS + i;
+        grid_bind_slot(&grid_slots[i], (v < grid_view_count) ? &entity_index[grid_view[v]] : NULL);
+    }
+
+    if (grid_page_label) {
+        if (pages > 1) {
+            lv_label_set_text_fmt(grid_page_label, "%u / %u", (unsigned)(grid_page + 1), (unsigned)pages);
+            lv_obj_clear_flag(grid_page_label, LV_OBJ_FLAG_HIDDEN);
         } else {
-            lv_obj_add_flag(btn, LV_OBJ_FLAG_HIDDEN);
+            lv_obj_add_flag(grid_page_label, LV_OBJ_FLAG_HIDDEN);
         }
     }
 }
 
+// State store subscriber: only entities bound to a slot need a redraw. The slot
+// is just marked; a burst of updates (dimmer ramps, moving covers, flapping
+// automations) costs one restyle per frame, using whatever the store holds then.
+static void grid_on_state_changed(const EntityState* st, void* ctx) {
+    EntityEntry* e = entity_index_find(st->id);
+    if (e == NULL || e->btn == NULL) return;
+    for (int i = 0; i < GRID_SLOTS; i++) {
+        if (grid_slots[i].btn != e->btn) continue;
+        uint8_t bit = 1u << i;
+        grid_state_updates++;
+        if (grid_dirty & bit) grid_state_coalesced++;
+        grid_dirty |= bit;
+        return;
+    }
+}
+
+// LV_EVENT_REFR_START: applies the latest state of every marked slot right
+// before LVGL renders, so the restyle lands in this frame.
+static void grid_flush_dirty(lv_event_t* e) {
+    if (grid_dirty == 0) return;
+    for (int i = 0; i < GRID_SLOTS; i++) {
+        if (!(grid_dirty & (1u << i)) || grid_slots[i].btn == NULL) continue;
+        const EntityState* st = entity_state_find((const char*)lv_obj_get_user_data(grid_slots[i].btn));
+        if (st) update_manual_switch_visuals(grid_slots[i].btn, st->on);
+    }
+    grid_dirty = 0;
+}
+
+// Command queue hook: marks the button while a command is in flight.
+static void grid_on_pending_changed(const char* id, bool pending) {
+    EntityEntry* e = entity_index_find(id);
+    if (e && e->btn) lv_obj_set_state(e->btn, LV_STATE_USER_1, pending);
+}
+
+void grid_rebuild_view() {
+    grid_view_count = room_index_filter(current_room_idx, grid_view);
+}
+
+void apply_switch_filter() {
+    grid_rebuild_view();
+    grid_page = 0;
+    grid_render();
+}
+
+// Up/down pages through the grid, left/right is passed on to screen navigation.
+void on_grid_gesture(lv_event_t* e) {
+    lv_dir_t dir = lv_indev_get_gesture_dir(lv_indev_active());
+    if (dir == LV_DIR_TOP) {
+        if (grid_page + 1 < grid_page_count()) { grid_page++; grid_render(); }
+    } else if (dir == LV_DIR_BOTTOM) {
+        if (grid_page > 0) { grid_page--; grid_render(); }
+    } else {
+        lv_obj_send_event(lv_obj_get_screen(ui_haswC), LV_EVENT_GESTURE, NULL);
+    }
+}
+
+static void build_grid_slot_job(void* arg) {
+    int i = (int)(intptr_t)arg;
+    GridSlot* s = &grid_slots[i];
+
+    lv_obj_t* sw_btn = lv_btn_create(ui_haswC);
+    lv_obj_remove_style_all(sw_btn); 
+    lv_obj_add_style(sw_btn, &style_sw_btn, LV_PART_MAIN);
+    lv_obj_add_style(sw_btn, &style_sw_pending, LV_PART_MAIN | LV_STATE_USER_1);
+    lv_obj_set_pos(sw_btn, grid_pos[i].x, grid_pos[i].y);
+    lv_obj_add_flag(sw_btn, (lv_obj_flag_t)(LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_HIDDEN));   // CHECKED follows the state store
+    lv_obj_clear_flag(sw_btn, LV_OBJ_FLAG_SCROLLABLE);
+
+    // Icon Cont
+    lv_obj_t* icon_cont = lv_obj_create(sw_btn);
+    lv_obj_remove_style_all(icon_cont);
+    lv_obj_add_style(icon_cont, &style_sw_icon_cont, LV_PART_MAIN);
+    lv_obj_add_style(icon_cont, &style_sw_icon_cont_on, LV_PART_MAIN | LV_STATE_CHECKED);
+    lv_obj_clear_flag(icon_cont, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_clear_flag(icon_cont, LV_OBJ_FLAG_SCROLLABLE);
+    
+    // Icon Img
+    lv_obj_t* img = lv_img_create(icon_cont);
+    lv_obj_add_style(img, &style_sw_img, LV_PART_MAIN);
+    lv_obj_add_style(img, &style_sw_img_on, LV_PART_MAIN | LV_STATE_CHECKED);
+    lv_obj_clear_flag(img, LV_OBJ_FLAG_CLICKABLE);
+
+    // Name
+    lv_obj_t* lbl_n = lv_label_create(sw_btn);
+    lv_label_set_text_static(lbl_n, "");
+    lv_obj_add_style(lbl_n, &style_sw_name, LV_PART_MAIN);
+    lv_obj_clear_flag(lbl_n, LV_OBJ_FLAG_CLICKABLE);
+
+    // Room
+    lv_obj_t* lbl_r = lv_label_create(sw_btn);
+    lv_label_set_text_static(lbl_r, "");
+    lv_obj_add_style(lbl_r, &style_sw_room, LV_PART_MAIN);
+    lv_obj_clear_flag(lbl_r, LV_OBJ_FLAG_CLICKABLE);
+
+    lv_obj_add_event_cb(sw_btn, on_manual_switch_toggle, LV_EVENT_CLICKED, NULL);
+
+    s->btn = sw_btn;
+    s->img = img;
+    s->lbl_name = lbl_n;
+    s->lbl_room = lbl_r;
+    s->name = s->icon = s->room = NULL;
+}
+
+// Replaces the SquareLine placeholder switch with the recycled slot pool.
+void grid_init() {
+    if (!ui_haswC) return;
+    lv_obj_clean(ui_haswC);
+    ui_CompSwitch = NULL;
+
+    lv_obj_set_layout(ui_haswC, LV_LAYOUT_NONE);
+    lv_obj_set_style_pad_all(ui_haswC, 0, 0);
+    lv_obj_add_flag(ui_haswC, LV_OBJ_FLAG_CLICKABLE);           // Catch swipes that start in the gaps
+    lv_obj_clear_flag(ui_haswC, LV_OBJ_FLAG_GESTURE_BUBBLE);
+    lv_obj_add_event_cb(ui_haswC, on_grid_gesture, LV_EVENT_GESTURE, NULL);
+    lv_display_add_event_cb(lv_obj_get_display(ui_haswC), grid_flush_dirty, LV_EVENT_REFR_START, NULL);
+
+    for (int i = 0; i < GRID_SLOTS; i++) {
+        grid_pos[i].x = (i % GRID_COLS) * (SW_WIDTH + GRID_GAP);
+        grid_pos[i].y = (i / GRID_COLS) * (SW_HEIGHT + GRID_GAP);
+        ui_builder_push(build_grid_slot_job, (void*)(intptr_t)i);
+    }
+
+    grid_page_label = lv_label_create(lv_obj_get_parent(ui_haswC));
+    lv_obj_set_align(grid_page_label, LV_ALIGN_BOTTOM_MID);
+    lv_obj_set_y(grid_page_label, -12);
+    lv_obj_set_style_text_font(grid_page_label, &lv_font_montserrat_12, LV_PART_MAIN);
+    lv_obj_set_style_text_color(grid_page_label, lv_color_hex(COLOR_TEXT_WHITE), LV_PART_MAIN);
+    lv_obj_set_style_text_opa(grid_page_label, 150, LV_PART_MAIN);
+    lv_obj_add_flag(grid_page_label, LV_OBJ_FLAG_HIDDEN);
+}
+
 void on_room_click(lv_event_t* e) {
     lv_obj_t* clicked_chip = (lv_obj_t*)lv_event_get_target(e);
     if (!ui_rmC) return;
-    
-    uint32_t count = lv_obj_get_child_cnt(ui_rmC);
-    for(uint32_t i=0; i<count; i++) {
-        lv_obj_t* chip = lv_obj_get_child(ui_rmC, i);
-        lv_obj_t* label = lv_obj_get_child(chip, 0); 
-        
-        if (chip == clicked_chip) {
-            lv_obj_set_style_bg_color(chip, lv_color_hex(COLOR_BLUE_ACTIVE), LV_PART_MAIN);
-            lv_obj_set_style_bg_opa(chip, 255, LV_PART_MAIN);
-            if(label) {
-                lv_obj_set_style_text_color(label, lv_color_hex(COLOR_TEXT_WHITE), LV_PART_MAIN);
-                current_room_filter = String(lv_label_get_text(label)); 
-            }
-        } else {
-            lv_obj_set_style_bg_color(chip, lv_color_hex(COLOR_BG_BLACK), LV_PART_MAIN);
-            lv_obj_set_style_bg_opa(chip, 80, LV_PART_MAIN); 
-            if(label) lv_obj_set_style_text_color(label, lv_color_hex(COLOR_TEXT_WHITE), LV_PART_MAIN);
-        }
-    }
+
+    int32_t idx = lv_obj_get_index(clicked_chip);   // Chips are created in room-list order
+    if (idx < 0 || idx >= room_count) return;
+
+    lv_obj_t* prev = lv_obj_get_child(ui_rmC, current_room_idx);
+    if (prev) lv_obj_clear_state(prev, LV_STATE_CHECKED);
+    lv_obj_add_state(clicked_chip, LV_STATE_CHECKED);
+
+    current_room_idx = (uint16_t)idx;
+    current_room_filter = room_names[idx];
     apply_switch_filter();
 }
 
@@ -146,43 +312,88 @@ void on_arrow_click(lv_event_t* e) {
     }
 }
 
-// --- MAIN BUILD ---
-void refresh_ui_data(const char* json_payload) {
-    Serial.print("UI: Build Start. Heap: "); Serial.println(ESP.getFreeHeap());
-    if (!ui_haswC || !ui_rmC) return;
+// --- ROOM CHIPS ---
+static lv_obj_t* create_room_chip(lv_obj_t* parent) {
+    lv_obj_t* chip = lv_btn_create(parent);
+    lv_obj_add_style(chip, &style_chip, LV_PART_MAIN);
+    lv_obj_add_style(chip, &style_chip_selected, LV_PART_MAIN | LV_STATE_CHECKED);
+    lv_obj_add_flag(chip, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_clear_flag(chip, LV_OBJ_FLAG_SCROLL_ON_FOCUS); 
 
-    JsonDocument* doc = new JsonDocument();
-    DeserializationError error = deserializeJson(*doc, json_payload);
-    if (error) { Serial.print("JSON Error"); delete doc; return; }
+    lv_obj_t* lbl = lv_label_create(chip);
+    lv_obj_add_style(lbl, &style_chip_label, LV_PART_MAIN);
+    lv_obj_clear_flag(lbl, LV_OBJ_FLAG_CLICKABLE);
 
-    JsonArray buttons = (*doc)["buttons"];
-    if (buttons.isNull()) buttons = (*doc)["switches"];
+    lv_obj_add_event_cb(chip, on_room_click, LV_EVENT_CLICKED, NULL);
+    return chip;
+}
+
+ObjPool chip_pool = OBJ_POOL_INIT("chips", create_room_chip);
+
+void rebuild_room_chips() {
+    obj_pool_release_children(&chip_pool, ui_rmC);
+    lv_obj_set_style_pad_column(ui_rmC, 10, 0); 
+
+    for (int i = 0; i < room_count; i++) {
+        lv_obj_t* chip = obj_pool_acquire(&chip_pool, ui_rmC);
+        if (!chip) break;
+        lv_label_set_text_static(lv_obj_get_child(chip, 0), room_names[i]);
+        lv_obj_set_state(chip, LV_STATE_CHECKED, i == current_room_idx);
+    }
+    
+    // --- ARROW LOGIC ---
+    if(ui_rmPe) {
+        lv_obj_set_style_border_width(ui_rmPe, 0, LV_PART_MAIN); 
+        lv_obj_set_style_transform_angle(ui_rmPe, 0, 0); 
+    }
+
+    lv_obj_update_layout(ui_rmC);
+    lv_obj_scroll_to_x(ui_rmC, 0, LV_ANIM_OFF);
     
-    // Cleanup
-    if (is_first_ui_update) {
-        lv_obj_clean(ui_haswC); 
-        is_first_ui_update = false;
+    if (lv_obj_get_scroll_right(ui_rmC) > 0) {
+        lv_obj_clear_flag(ui_rmPe, LV_OBJ_FLAG_HIDDEN);
     } else {
-        uint32_t count = lv_obj_get_child_cnt(ui_haswC);
-        for(uint32_t i=0; i<count; i++) {
-            lv_obj_t* btn = lv_obj_get_child(ui_haswC, i);
-            void* ud = lv_obj_get_user_data(btn); 
-            if(ud) free(ud);
-        }
-        lv_obj_clean(ui_haswC);
+        lv_obj_add_flag(ui_rmPe, LV_OBJ_FLAG_HIDDEN);
     }
-    lv_obj_clean(ui_rmC);
+}
+
+// --- BUILD JOBS (run by ui_builder) ---
+static void build_chips_job(void* arg) {
+    LOG_D("UI: Rebuilding chips");
+    rebuild_room_chips();
+}
 
-    if (buttons.isNull() || buttons.size() == 0) {
+static void finish_grid_job(void* arg) {
+    int unknown = (int)(intptr_t)arg;
+    grid_render();   // Binds slots whose widgets were still queued when apply_layout() rendered
+
+    LOG_I("UI: Build complete. %d entities, %d without state", entity_count, unknown);
+    // The state store already covers everything HA has reported; only ask for the rest
+    if (unknown > 0 && mqtt_link_ready()) mqtt.publish("ha/panel/sync", "get_states");
+}
+
+// --- MAIN BUILD ---
+// Builds the grid from a parsed layout (from the config or the flash cache).
+// layout_index_apply() diffs it against the entity index; this adds the widget
+// side. The item strings only need to stay valid for the duration of the call.
+// Chips are rebuilt on the UI builder, and only when the room list changed.
+void apply_layout(const LayoutItem* items, uint16_t count) {
+    LOG_I("UI: Build start. Heap: %u", (unsigned)ESP.getFreeHeap());
+    ui_builder_finish();   // Jobs from a previous config must not see the new index
+
+    if (count == 0) {
         // --- EMPTY STATE ---
+        obj_pool_release_children(&chip_pool, ui_rmC);
+        layout_index_apply(items, 0);
+        grid_view_count = 0;
+        grid_render();
+
         lv_obj_clear_flag(ui_haswCnd, LV_OBJ_FLAG_HIDDEN); // Show "No Data"
         lv_obj_add_flag(ui_haswC, LV_OBJ_FLAG_HIDDEN);     // Hide Grid
         
         // Hide Navigation Elements
         if(ui_rmC) lv_obj_add_flag(ui_rmC, LV_OBJ_FLAG_HIDDEN);
         if(ui_rmPe) lv_obj_add_flag(ui_rmPe, LV_OBJ_FLAG_HIDDEN);
-        
-        delete doc; 
         return;
     } else {
         // --- DATA EXISTS ---
@@ -191,173 +402,95 @@ void refresh_ui_data(const char* json_payload) {
         
         // Show Navigation Elements
         if(ui_rmC) lv_obj_clear_flag(ui_rmC, LV_OBJ_FLAG_HIDDEN);
-        // Arrow visibility is determined later by overflow check
-        
-        lv_obj_set_flex_flow(ui_haswC, LV_FLEX_FLOW_ROW_WRAP);
-        lv_obj_set_flex_align(ui_haswC, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START, LV_FLEX_ALIGN_START);
-        lv_obj_set_style_pad_row(ui_haswC, 10, 0);
-        lv_obj_set_style_pad_column(ui_haswC, 10, 0);
-        lv_obj_set_style_pad_all(ui_haswC, 0, 0);
-        
-        lv_obj_set_style_pad_column(ui_rmC, 10, 0); 
+        // Arrow visibility is determined when the chips are built
     }
 
-    const int MAX_ROOMS = 10;
-    char room_list[MAX_ROOMS][32]; 
-    strcpy(room_list[0], "My Home");
-    int room_count = 1;
-
-    // --- SWITCHES ---
-    Serial.println("UI: Creating Switches...");
-    int idx = 0;
-    for (JsonObject btn : buttons) {
-        if (idx++ >= 6) break; 
-
-        const char* name = btn["name"] | "Dev"; 
-        const char* entity = btn["entity"] | ""; 
-        const char* icon = btn["icon"] | "power";   
-        const char* room = btn["room"] | "Home"; 
-        const char* state = btn["state"] | "OFF";
-
-        lv_obj_t* sw_btn = lv_btn_create(ui_haswC);
-        lv_obj_remove_style_all(sw_btn); 
-        lv_obj_set_width(sw_btn, SW_WIDTH);
-        lv_obj_set_height(sw_btn, SW_HEIGHT);
-        lv_obj_add_flag(sw_btn, (lv_obj_flag_t)(LV_OBJ_FLAG_CHECKABLE | LV_OBJ_FLAG_CLICKABLE));
-        lv_obj_clear_flag(sw_btn, LV_OBJ_FLAG_SCROLLABLE);
-        
-        lv_obj_set_style_radius(sw_btn, 12, LV_PART_MAIN);
-        lv_obj_set_style_bg_color(sw_btn, lv_color_hex(COLOR_BG_BLACK), LV_PART_MAIN);
-        lv_obj_set_style_bg_opa(sw_btn, 80, LV_PART_MAIN); 
-        
-        char* entity_store = strdup(entity); 
-        lv_obj_set_user_data(sw_btn, (void*)entity_store);
-
-        // Icon Cont
-        lv_obj_t* icon_cont = lv_obj_create(sw_btn);
-        lv_obj_remove_style_all(icon_cont);
-        lv_obj_set_size(icon_cont, 50, 50);
-        lv_obj_set_pos(icon_cont, 10, 0);
-        lv_obj_set_align(icon_cont, LV_ALIGN_LEFT_MID);
-        lv_obj_set_style_radius(icon_cont, 50, LV_PART_MAIN); 
-        lv_obj_set_style_bg_color(icon_cont, lv_color_hex(COLOR_BG_BLACK), LV_PART_MAIN);
-        lv_obj_set_style_bg_opa(icon_cont, 80, LV_PART_MAIN); 
-        lv_obj_clear_flag(icon_cont, LV_OBJ_FLAG_CLICKABLE);
-        lv_obj_clear_flag(icon_cont, LV_OBJ_FLAG_SCROLLABLE);
-        
-        // Icon Img
-        lv_obj_t* img = lv_img_create(icon_cont);
-        lv_img_set_src(img, get_icon_by_name(icon));
-        lv_obj_center(img);
-        lv_obj_set_style_bg_opa(img, 0, LV_PART_MAIN);
-        lv_obj_set_style_border_width(img, 0, LV_PART_MAIN); 
-        lv_obj_set_style_img_recolor(img, lv_color_hex(COLOR_INACTIVE_GREY), LV_PART_MAIN);
-        lv_obj_set_style_img_recolor_opa(img, 255, LV_PART_MAIN);
-        lv_obj_clear_flag(img, LV_OBJ_FLAG_CLICKABLE);
-
-        // Name
-        lv_obj_t* lbl_n = lv_label_create(sw_btn);
-        lv_obj_set_width(lbl_n, 125);
-        lv_obj_set_height(lbl_n, 20);
-        lv_obj_set_pos(lbl_n, -10, -5);
-        lv_obj_set_align(lbl_n, LV_ALIGN_RIGHT_MID);
-        lv_label_set_text(lbl_n, name);
-        lv_obj_set_style_text_color(lbl_n, lv_color_hex(COLOR_TEXT_WHITE), LV_PART_MAIN);
-        lv_obj_set_style_text_align(lbl_n, LV_TEXT_ALIGN_LEFT, LV_PART_MAIN);
-        lv_obj_set_style_text_font(lbl_n, &lv_font_montserrat_16, LV_PART_MAIN);
-        lv_obj_clear_flag(lbl_n, LV_OBJ_FLAG_CLICKABLE);
-
-        // Room
-        lv_obj_t* lbl_r = lv_label_create(sw_btn);
-        lv_obj_set_width(lbl_r, 125);
-        lv_obj_set_height(lbl_r, 16);
-        lv_obj_set_pos(lbl_r, -10, -14);
-        lv_obj_set_align(lbl_r, LV_ALIGN_BOTTOM_RIGHT);
-        lv_label_set_text(lbl_r, room);
-        lv_obj_set_style_text_color(lbl_r, lv_color_hex(COLOR_TEXT_WHITE), LV_PART_MAIN);
-        lv_obj_set_style_text_align(lbl_r, LV_TEXT_ALIGN_LEFT, LV_PART_MAIN);
-        lv_obj_set_style_text_font(lbl_r, &lv_font_montserrat_12, LV_PART_MAIN);
-        lv_obj_clear_flag(lbl_r, LV_OBJ_FLAG_CLICKABLE);
-
-        // INITIAL STATE LOGIC
-        bool is_on = (strcasecmp(state, "ON") == 0);
-        if (is_on) lv_obj_add_state(sw_btn, LV_STATE_CHECKED);
-        update_manual_switch_visuals(sw_btn, is_on);
-
-        lv_obj_add_event_cb(sw_btn, on_manual_switch_toggle, LV_EVENT_CLICKED, (void*)entity_store);
-
-        // Room Collection
-        bool exists = false;
-        for(int k=0; k<room_count; k++) {
-            if(strcmp(room_list[k], room) == 0) { exists = true; break; }
-        }
-        if(!exists && room_count < MAX_ROOMS) {
-            strncpy(room_list[room_count], room, 31);
-            room_list[room_count][31] = '\0'; 
-            room_count++;
-        }
-        delay(5); 
-    }
+    LayoutIndexResult res = layout_index_apply(items, count);
 
-    // --- CHIPS ---
-    Serial.println("UI: Creating Chips...");
-    for (int i = 0; i < room_count; i++) {
-        lv_obj_t* chip = lv_btn_create(ui_rmC);
-        
-        lv_obj_set_height(chip, 30);
-        lv_obj_set_width(chip, LV_SIZE_CONTENT);
-        lv_obj_set_style_pad_hor(chip, 14, LV_PART_MAIN);
-        lv_obj_set_style_radius(chip, 24, LV_PART_MAIN);
-        lv_obj_set_style_border_width(chip, 0, LV_PART_MAIN);
-        lv_obj_set_style_shadow_width(chip, 0, LV_PART_MAIN);
-        
-        lv_obj_add_flag(chip, LV_OBJ_FLAG_CLICKABLE);
-        lv_obj_clear_flag(chip, LV_OBJ_FLAG_SCROLL_ON_FOCUS); 
-
-        lv_obj_t* lbl = lv_label_create(chip);
-        lv_label_set_text(lbl, room_list[i]);
-        lv_obj_center(lbl);
-        lv_obj_set_style_text_font(lbl, &lv_font_montserrat_14, 0);
-        lv_obj_clear_flag(lbl, LV_OBJ_FLAG_CLICKABLE);
-
-        if (String(room_list[i]) == current_room_filter) {
-            lv_obj_set_style_bg_color(chip, lv_color_hex(COLOR_BLUE_ACTIVE), LV_PART_MAIN);
-            lv_obj_set_style_bg_opa(chip, 255, LV_PART_MAIN);
-            lv_obj_set_style_text_color(lbl, lv_color_hex(COLOR_TEXT_WHITE), 0);
-        } else {
-            lv_obj_set_style_bg_color(chip, lv_color_hex(COLOR_BG_BLACK), LV_PART_MAIN);
-            lv_obj_set_style_bg_opa(chip, 80, LV_PART_MAIN); 
-            lv_obj_set_style_text_color(lbl, lv_color_hex(COLOR_TEXT_WHITE), 0);
-        }
+    // The view holds index positions, so it is rebuilt together with the sort:
+    // a page flip or redraw before the queued jobs run must not see old positions.
+    // Room ids may have moved too; the filter follows the room by name.
+    current_room_idx = room_index_find(intern_string(current_room_filter));
+    if (current_room_idx == 0) current_room_filter = "My Home";
+    grid_rebuild_view();
+    grid_render();   // Keeps the current page where possible
 
-        lv_obj_add_event_cb(chip, on_room_click, LV_EVENT_CLICKED, NULL);
-        delay(5);
-    }
-    
-    // --- ARROW LOGIC ---
-    if(ui_rmPe) {
-        lv_obj_set_style_border_width(ui_rmPe, 0, LV_PART_MAIN); 
-        lv_obj_set_style_transform_angle(ui_rmPe, 0, 0); 
+    if (res.rooms_changed) ui_builder_push(build_chips_job);
+    ui_builder_push(finish_grid_job, (void*)(intptr_t)res.unknown);
+}
+
+bool layout_applied = false;
+uint32_t applied_config_hash = 0;   // FNV-1a of the config JSON currently shown
+
+// `payload` is a JSON or MessagePack config (see panel_codec.h)
+void refresh_ui_data(const char* payload, size_t len) {
+    if (!ui_haswC || !ui_rmC) return;
+
+    // The retained config is re-delivered on every reconnect; usually it is what the cache already built
+    uint32_t hash = fnv1a_n(payload, len);
+    if (layout_applied && hash == applied_config_hash) {
+        LOG_I("UI: Config unchanged, skipping rebuild");
+        return;
     }
 
-    lv_obj_update_layout(ui_rmC);
-    lv_obj_scroll_to_x(ui_rmC, 0, LV_ANIM_OFF);
-    
-    if (lv_obj_get_scroll_right(ui_rmC) > 0) {
-        lv_obj_clear_flag(ui_rmPe, LV_OBJ_FLAG_HIDDEN);
-    } else {
-        lv_obj_add_flag(ui_rmPe, LV_OBJ_FLAG_HIDDEN);
+    JsonDocument* doc = new JsonDocument(&json_allocator);
+    DeserializationError error = panel_deserialize(*doc, payload, len);
+    if (error) { LOG_E("UI: Config error: %s", error.c_str()); delete doc; return; }
+
+    JsonArray buttons = (*doc)["buttons"];
+    if (buttons.isNull()) buttons = (*doc)["switches"];
+
+    uint16_t count = 0;
+    LayoutItem* items = NULL;
+    if (!buttons.isNull() && buttons.size() > 0) {
+        items = (LayoutItem*)hd_malloc(HT_LAYOUT, buttons.size() * sizeof(LayoutItem));
+        if (items == NULL) { LOG_E("UI: Out of memory for layout"); delete doc; return; }
+        for (JsonObject btn : buttons) {
+            LayoutItem* item = &items[count++];
+            item->entity = btn["entity"] | "";
+            item->name = btn["name"] | "Dev";
+            item->icon = btn["icon"] | "power";
+            item->room = btn["room"] | "Home";
+            item->on = state_payload_is_on(btn["state"] | "OFF");
+        }
     }
 
-    Serial.println("UI: Build Complete. Requesting Sync...");
+    apply_layout(items, count);
+    layout_cache_save(hash, items, count);
+    layout_applied = true;
+    applied_config_hash = hash;
+
+    hd_free(items);
     delete doc;
-    
-    // ** FORCE STATE SYNC AFTER BUILD **
-    if (mqtt.connected()) mqtt.publish("ha/panel/sync", "get_states");
+}
+
+// Builds the grid from the flash cache during setup(), before any network is up.
+bool load_cached_layout() {
+    if (!ui_haswC || !ui_rmC) return false;
+    LayoutItem* items;
+    uint16_t count;
+    uint32_t hash;
+    if (!layout_cache_load(&items, &count, &hash)) return false;
+
+    LOG_I("UI: Building %u buttons from the layout cache", count);
+    apply_layout(items, count);
+    layout_applied = true;
+    applied_config_hash = hash;
+    hd_free(items);
+    return true;
 }
 
 // --- INIT HELPER TO SET PIVOT ---
 void setup_ui_logic() {
+    ui_styles_init();
+    grid_init();
+    entity_state_subscribe(grid_on_state_changed);
+    cmd_queue_pending_cb = grid_on_pending_changed;
+    if (ui_rmC) {
+        lv_obj_clean(ui_rmC);   // Drop the SquareLine placeholder chip, chips come from chip_pool
+        ui_CompRoom = NULL;
+    }
+
     if(ui_rmPe) {
         lv_obj_add_event_cb(ui_rmPe, on_arrow_click, LV_EVENT_CLICKED, NULL);
         lv_obj_set_style_transform_pivot_x(ui_rmPe, LV_PCT(50), 0);
@@ -366,19 +499,42 @@ void setup_ui_logic() {
 }
 
 // --- UPDATE FROM MQTT ---
-void update_device_state(const char* entity_id, bool is_on) {
-    if (!ui_haswC) return;
-    uint32_t count = lv_obj_get_child_cnt(ui_haswC);
-    for(uint32_t i=0; i<count; i++) {
-        lv_obj_t* btn = lv_obj_get_child(ui_haswC, i);
-        const char* id = (const char*)lv_obj_get_user_data(btn);
-        if (id && strcmp(id, entity_id) == 0) {
-            if (is_on) lv_obj_add_state(btn, LV_STATE_CHECKED);
-            else lv_obj_clear_state(btn, LV_STATE_CHECKED);
-            update_manual_switch_visuals(btn, is_on);
-            return; 
-        }
-    }
+// Writes go to the state store, also for entities that are not on screen;
+// subscribers redraw whatever is visible. IDs the config does not know are
+// dropped: anything on ha/panel/state/+ would otherwise be stored and interned
+// for good. A config that adds entities asks HA for their states (ha/panel/sync).
+void update_device_state(const char* entity_id, bool is_on, uint8_t brightness = STATE_UNKNOWN, uint8_t position = STATE_UNKNOWN) {
+    const EntityState* st = entity_state_find(entity_id);
+    if (st == NULL) return;
+    // Before the store, which drops unchanged values. While a command is pending
+    // the optimistic on/off stays; brightness and position still update.
+    if (cmd_queue_on_report(entity_id, is_on)) is_on = st->on;
+    entity_state_set(entity_id, is_on, brightness, position);
+}
+
+static uint8_t state_field_u8(JsonVariantConst v, int max) {
+    if (!v.is<int>()) return STATE_UNKNOWN;
+    int x = v.as<int>();
+    if (x < 0) x = 0;
+    if (x > max) x = max;
+    return (uint8_t)x;
+}
+
+// {"entity_id": ..., "state": ..., "brightness": 0-255, "position": 0-100}
+// brightness/position are optional. Falls back to `entity_id` for per-entity topics.
+void update_device_state_json(JsonObjectConst s, const char* entity_id = NULL) {
+    const char* id = s["entity_id"] | entity_id;
+    if (id == NULL) return;
+    JsonVariantConst pos = s["position"];
+    if (pos.isNull()) pos = s["current_position"];
+    update_device_state(id, state_payload_is_on(s["state"]),
+                        state_field_u8(s["brightness"], 254), state_field_u8(pos, 100));
+}
+
+// --- BATCHED UPDATE FROM MQTT ---
+// Only the store is written here; the grid restyles once at the next frame.
+void update_device_states(JsonArrayConst states) {
+    for (JsonObjectConst s : states) update_device_state_json(s);
 }
 
-#endif
\ No newline at end of file
+#endif
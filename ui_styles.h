@@ -0,0 +1,115 @@
+#ifndef UI_STYLES_H
+#define UI_STYLES_H
+
+#include <lvgl.h>
+
+// --- SHARED STYLES ---
+// Dynamically built switches and room chips share these instead of carrying
+// their own local style properties. "On" and "selected" are the CHECKED
+// variants, so a toggle is a single state change and LVGL resolves the rest.
+
+#define COLOR_ACTIVE_YELLOW  0xFEC106
+#define COLOR_INACTIVE_GREY  0xD6D6D6
+#define COLOR_BG_BLACK       0x000000
+#define COLOR_TEXT_WHITE     0xFFFFFF
+#define COLOR_BLUE_ACTIVE    0x28A0FB
+
+// Dimensions
+#define SW_WIDTH   205
+#define SW_HEIGHT  70
+
+lv_style_t style_sw_btn;
+lv_style_t style_sw_pending;     // LV_STATE_USER_1: command sent, waiting for HA
+lv_style_t style_sw_icon_cont;
+lv_style_t style_sw_icon_cont_on;
+lv_style_t style_sw_img;
+lv_style_t style_sw_img_on;
+lv_style_t style_sw_name;
+lv_style_t style_sw_room;
+lv_style_t style_chip;
+lv_style_t style_chip_selected;
+lv_style_t style_chip_label;
+
+void ui_styles_init() {
+    if (style_sw_btn.prop_cnt != 0) return;
+
+    // Switch button
+    lv_style_init(&style_sw_btn);
+    lv_style_set_width(&style_sw_btn, SW_WIDTH);
+    lv_style_set_height(&style_sw_btn, SW_HEIGHT);
+    lv_style_set_radius(&style_sw_btn, 12);
+    lv_style_set_bg_color(&style_sw_btn, lv_color_hex(COLOR_BG_BLACK));
+    lv_style_set_bg_opa(&style_sw_btn, 80);
+
+    lv_style_init(&style_sw_pending);
+    lv_style_set_outline_width(&style_sw_pending, 2);
+    lv_style_set_outline_color(&style_sw_pending, lv_color_hex(COLOR_ACTIVE_YELLOW));
+    lv_style_set_outline_opa(&style_sw_pending, 120);
+
+    // Icon circle
+    lv_style_init(&style_sw_icon_cont);
+    lv_style_set_width(&style_sw_icon_cont, 50);
+    lv_style_set_height(&style_sw_icon_cont, 50);
+    lv_style_set_x(&style_sw_icon_cont, 10);
+    lv_style_set_align(&style_sw_icon_cont, LV_ALIGN_LEFT_MID);
+    lv_style_set_radius(&style_sw_icon_cont, 50);
+    lv_style_set_bg_color(&style_sw_icon_cont, lv_color_hex(COLOR_BG_BLACK));
+    lv_style_set_bg_opa(&style_sw_icon_cont, 80);
+
+    lv_style_init(&style_sw_icon_cont_on);
+    lv_style_set_bg_color(&style_sw_icon_cont_on, lv_color_hex(COLOR_ACTIVE_YELLOW));
+
+    // Icon image
+    lv_style_init(&style_sw_img);
+    lv_style_set_align(&style_sw_img, LV_ALIGN_CENTER);
+    lv_style_set_bg_opa(&style_sw_img, 0);
+    lv_style_set_border_width(&style_sw_img, 0);
+    lv_style_set_image_recolor(&style_sw_img, lv_color_hex(COLOR_INACTIVE_GREY));
+    lv_style_set_image_recolor_opa(&style_sw_img, 255);
+
+    lv_style_init(&style_sw_img_on);
+    lv_style_set_image_recolor(&style_sw_img_on, lv_color_hex(COLOR_ACTIVE_YELLOW));
+
+    // Name and room labels
+    lv_style_init(&style_sw_name);
+    lv_style_set_width(&style_sw_name, 125);
+    lv_style_set_height(&style_sw_name, 20);
+    lv_style_set_x(&style_sw_name, -10);
+    lv_style_set_y(&style_sw_name, -5);
+    lv_style_set_align(&style_sw_name, LV_ALIGN_RIGHT_MID);
+    lv_style_set_text_color(&style_sw_name, lv_color_hex(COLOR_TEXT_WHITE));
+    lv_style_set_text_align(&style_sw_name, LV_TEXT_ALIGN_LEFT);
+    lv_style_set_text_font(&style_sw_name, &lv_font_montserrat_16);
+
+    lv_style_init(&style_sw_room);
+    lv_style_set_width(&style_sw_room, 125);
+    lv_style_set_height(&style_sw_room, 16);
+    lv_style_set_x(&style_sw_room, -10);
+    lv_style_set_y(&style_sw_room, -14);
+    lv_style_set_align(&style_sw_room, LV_ALIGN_BOTTOM_RIGHT);
+    lv_style_set_text_color(&style_sw_room, lv_color_hex(COLOR_TEXT_WHITE));
+    lv_style_set_text_align(&style_sw_room, LV_TEXT_ALIGN_LEFT);
+    lv_style_set_text_font(&style_sw_room, &lv_font_montserrat_12);
+
+    // Room chips (on top of the theme's button style)
+    lv_style_init(&style_chip);
+    lv_style_set_height(&style_chip, 30);
+    lv_style_set_width(&style_chip, LV_SIZE_CONTENT);
+    lv_style_set_pad_hor(&style_chip, 14);
+    lv_style_set_radius(&style_chip, 24);
+    lv_style_set_border_width(&style_chip, 0);
+    lv_style_set_shadow_width(&style_chip, 0);
+    lv_style_set_bg_color(&style_chip, lv_color_hex(COLOR_BG_BLACK));
+    lv_style_set_bg_opa(&style_chip, 80);
+
+    lv_style_init(&style_chip_selected);
+    lv_style_set_bg_color(&style_chip_selected, lv_color_hex(COLOR_BLUE_ACTIVE));
+    lv_style_set_bg_opa(&style_chip_selected, 255);
+
+    lv_style_init(&style_chip_label);
+    lv_style_set_align(&style_chip_label, LV_ALIGN_CENTER);
+    lv_style_set_text_color(&style_chip_label, lv_color_hex(COLOR_TEXT_WHITE));
+    lv_style_set_text_font(&style_chip_label, &lv_font_montserrat_14);
+}
+
+#endif